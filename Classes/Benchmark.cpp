@@ -0,0 +1,395 @@
+#include "Benchmark.h"
+
+#include <new>
+#include <tuple>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+
+#include <glm/gtc/constants.hpp>
+
+#include "main.h"
+#include "Chunk.h"
+#include "Blocks.h"
+#include "Camera.h"
+#include "Player.h"
+#include "Shader.h"
+
+const int BENCHMARK_SEED = 1337;
+
+// The render benchmark flies one lap around a circle, after waiting for the world around its start to load.
+const int RENDER_BENCHMARK_DISTANCE = 8;
+const float CAMERA_PATH_RADIUS = 96.0f;
+const float CAMERA_PATH_HEIGHT = 72.0f;
+const float CAMERA_PATH_PITCH = -20.0f;
+const double LOADING_TIMEOUT = 60.0;
+
+static std::atomic_bool CountAllocations(false);
+static std::atomic<long> Allocations(0);
+
+// Heap allocations are only counted by the CraftmineBenchmark build, which replaces the global allocation
+// functions. The game itself keeps the standard ones.
+#ifdef BENCHMARK_ALLOCATIONS
+static void* Allocate(std::size_t size) {
+    if (CountAllocations) {
+        ++Allocations;
+    }
+
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(std::size_t size) {
+    void* pointer = Allocate(size);
+
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
+
+#ifdef __cpp_aligned_new
+static void* Allocate_Aligned(std::size_t size, std::align_val_t alignment) {
+    if (CountAllocations) {
+        ++Allocations;
+    }
+
+#ifdef _WIN32
+    return _aligned_malloc(size == 0 ? 1 : size, static_cast<std::size_t>(alignment));
+#else
+    void* pointer = nullptr;
+    return posix_memalign(&pointer, static_cast<std::size_t>(alignment), size == 0 ? 1 : size) == 0 ? pointer : nullptr;
+#endif
+}
+
+static void Free_Aligned(void* pointer) {
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    void* pointer = Allocate_Aligned(size, alignment);
+
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+
+    return pointer;
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return Allocate_Aligned(size, alignment);
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return Allocate_Aligned(size, alignment);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    Free_Aligned(pointer);
+}
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    Free_Aligned(pointer);
+}
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+    Free_Aligned(pointer);
+}
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {
+    Free_Aligned(pointer);
+}
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+    Free_Aligned(pointer);
+}
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+    Free_Aligned(pointer);
+}
+#endif
+#endif
+
+// Sets the visible faces of every block, treating everything outside the chunk as air.
+static void Update_Air(Chunk* chunk) {
+    for (int x = 0; x < CHUNK_SIZE; ++x) {
+        for (int y = 0; y < CHUNK_SIZE; ++y) {
+            for (int z = 0; z < CHUNK_SIZE; ++z) {
+                glm::ivec3 tile(x, y, z);
+
+                if (chunk->Get_Type(tile) == 0) {
+                    continue;
+                }
+
+                for (int bit = 0; bit < 6; ++bit) {
+                    glm::ivec3 neighbor = tile;
+                    neighbor[bit / 2] += (bit % 2) ? 1 : -1;
+
+                    bool air = glm::any(glm::lessThan(neighbor, glm::ivec3(0))) ||
+                               glm::any(glm::greaterThanEqual(neighbor, glm::ivec3(CHUNK_SIZE)));
+
+                    if (!air) {
+                        int type = chunk->Get_Type(neighbor);
+                        const Block* block = Blocks::Get_Block(type, chunk->Get_Data(neighbor));
+                        air = type == 0 || !block->FullBlock || block->Transparent;
+                    }
+
+                    if (air) {
+                        chunk->Get_Air_Ref(tile) |= 1 << bit;
+                    }
+                }
+            }
+        }
+    }
+}
+
+static Chunk* Fill_Chunk(std::function<const Block*(glm::ivec3)> fill) {
+    Chunk* chunk = new Chunk(glm::vec3(0));
+
+    for (int x = 0; x < CHUNK_SIZE; ++x) {
+        for (int y = 0; y < CHUNK_SIZE; ++y) {
+            for (int z = 0; z < CHUNK_SIZE; ++z) {
+                glm::ivec3 tile(x, y, z);
+                const Block* block = fill(tile);
+
+                if (block != nullptr) {
+                    chunk->Set_Type(tile, block->ID);
+                    chunk->Set_Data(tile, block->Data);
+                }
+            }
+        }
+    }
+
+    Update_Air(chunk);
+    return chunk;
+}
+
+// Generates a column of terrain and returns the chunk with the most geometry.
+static Chunk* Generate_Terrain() {
+    Chunks::Seed(BENCHMARK_SEED);
+
+    Chunk* best = nullptr;
+    unsigned long bestSize = 0;
+
+    for (int y = 3; y >= -3; --y) {
+        Chunk* chunk = new Chunk(glm::vec3(0, y, 0));
+        chunk->Generate();
+        chunk->Mesh();
+
+        if (best == nullptr || chunk->VBOData.size() > bestSize) {
+            delete best;
+            best = chunk;
+            bestSize = chunk->VBOData.size();
+        }
+        else {
+            delete chunk;
+        }
+    }
+
+    return best;
+}
+
+static void Run(const char* name, Chunk* chunk, int iterations) {
+    Allocations = 0;
+    CountAllocations = true;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        chunk->Meshed = false;
+        chunk->Mesh();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    CountAllocations = false;
+
+    double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    double voxels = static_cast<double>(iterations) * CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+
+#ifdef BENCHMARK_ALLOCATIONS
+    std::printf(
+        "%-14s %12.2f %12lu %14.1f\n", name, nanoseconds / voxels,
+        static_cast<unsigned long>(chunk->VBOData.size() / CHUNK_VERTEX_SIZE),
+        static_cast<double>(Allocations) / iterations
+    );
+#else
+    std::printf(
+        "%-14s %12.2f %12lu %14s\n", name, nanoseconds / voxels,
+        static_cast<unsigned long>(chunk->VBOData.size() / CHUNK_VERTEX_SIZE), "-"
+    );
+#endif
+
+    delete chunk;
+}
+
+// Moves the camera to a point along the path, and loads the chunks around it.
+static void Move_Camera(float progress) {
+    float angle = progress * glm::two_pi<float>();
+
+    Cam.Position = glm::vec3(glm::cos(angle), 0, glm::sin(angle)) * CAMERA_PATH_RADIUS;
+    Cam.Position.y = CAMERA_PATH_HEIGHT;
+
+    // Face along the circle.
+    Cam.Yaw = glm::degrees(angle) + 90.0f;
+    Cam.Pitch = CAMERA_PATH_PITCH;
+    Cam.UpdateCameraVectors();
+
+    glm::vec3 chunk, tile;
+    std::tie(chunk, tile) = Get_Chunk_Pos(Cam.Position);
+
+    player.WorldPos = Cam.Position;
+    player.CurrentTile = tile;
+
+    if (chunk != player.CurrentChunk) {
+        player.CurrentChunk = chunk;
+        player.Queue_Chunks();
+    }
+}
+
+static bool World_Loaded() {
+    for (auto const &chunk : ChunkMap) {
+        if (!chunk.second->Meshed || !chunk.second->DataUploaded) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int Benchmark::Render_Path(int frames, std::string path, std::function<void()> renderFrame) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+
+    if (file == nullptr || frames <= 0) {
+        std::printf("Couldn't set up the render benchmark.\n");
+        return 1;
+    }
+
+    RENDER_DISTANCE = RENDER_BENCHMARK_DISTANCE;
+    DeltaTime = 1.0 / 60.0;
+
+    Chunks::Seed(BENCHMARK_SEED);
+
+    player.CurrentChunk = glm::vec3(0.5f);
+    Move_Camera(0.0f);
+
+    auto loadingStart = std::chrono::steady_clock::now();
+    double loadingTime = 0.0;
+
+    // Render the starting view until every chunk around it has been meshed and uploaded.
+    while (loadingTime < LOADING_TIMEOUT && (ChunkMap.empty() || !World_Loaded())) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderFrame();
+        glFinish();
+
+        loadingTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadingStart).count();
+    }
+
+    std::printf("Loaded %d chunks in %.2f seconds.\n", static_cast<int>(ChunkMap.size()), loadingTime);
+
+    std::fprintf(file, "frame,cpu_ms,gpu_wait_ms,draw_calls,draw_state_calls,vertices,chunks,chunks_in_view,chunks_drawn\n");
+
+    double totalTime = 0.0;
+    double worstTime = 0.0;
+
+    for (int frame = 0; frame < frames; ++frame) {
+        Move_Camera(static_cast<float>(frame) / frames);
+
+        DrawStateCalls = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderFrame();
+
+        auto submitted = std::chrono::steady_clock::now();
+        glFinish();
+        auto finished = std::chrono::steady_clock::now();
+
+        double cpuTime = std::chrono::duration<double, std::milli>(submitted - start).count();
+        double gpuWait = std::chrono::duration<double, std::milli>(finished - submitted).count();
+
+        int frustumChunks, drawnChunks;
+        std::tie(frustumChunks, drawnChunks) = Chunks::Get_Cull_Stats();
+
+        std::fprintf(
+            file, "%d,%.3f,%.3f,%d,%d,%d,%d,%d,%d\n", frame, cpuTime, gpuWait,
+            Chunks::Get_Draw_Calls(), DrawStateCalls, Chunks::Get_Drawn_Vertices(),
+            static_cast<int>(ChunkMap.size()), frustumChunks, drawnChunks
+        );
+
+        totalTime += cpuTime;
+        worstTime = std::max(worstTime, cpuTime);
+    }
+
+    std::fclose(file);
+
+    std::printf(
+        "Rendered %d frames, %.3f ms average and %.3f ms worst CPU time. Wrote %s.\n",
+        frames, totalTime / frames, worstTime, path.c_str()
+    );
+
+    return 0;
+}
+
+int Benchmark::Mesh_Chunks(int iterations) {
+    const Block* stone = Blocks::Get_Block("Stone");
+    const Block* torch = Blocks::Get_Block("Torch");
+
+    if (stone == nullptr || torch == nullptr || iterations <= 0) {
+        std::printf("Couldn't set up the meshing benchmark.\n");
+        return 1;
+    }
+
+    std::mt19937 rng(BENCHMARK_SEED);
+    std::bernoulli_distribution half(0.5);
+
+    std::printf("%-14s %12s %12s %14s\n", "Volume", "ns/voxel", "Vertices", "Allocations");
+
+    Run("Empty", Fill_Chunk([](glm::ivec3) -> const Block* { return nullptr; }), iterations);
+    Run("Solid", Fill_Chunk([stone](glm::ivec3) { return stone; }), iterations);
+
+    Run("Checkerboard", Fill_Chunk([stone](glm::ivec3 tile) -> const Block* {
+        return ((tile.x + tile.y + tile.z) % 2) ? stone : nullptr;
+    }), iterations);
+
+    Run("Random", Fill_Chunk([stone, &rng, &half](glm::ivec3) -> const Block* {
+        return half(rng) ? stone : nullptr;
+    }), iterations);
+
+    Run("Terrain", Generate_Terrain(), iterations);
+    Run("Custom Models", Fill_Chunk([torch](glm::ivec3) { return torch; }), iterations);
+
+    return 0;
+}
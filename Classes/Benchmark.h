@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+#include <functional>
+
+namespace Benchmark {
+    // Meshes chunks built from fixed volumes and prints the time, vertices and allocations per mesh.
+    // Doesn't need a window or an OpenGL context.
+    int Mesh_Chunks(int iterations);
+
+    // Loads a fixed-seed world, flies the camera along a fixed path while rendering it with the given function,
+    // and writes the CPU time, draw calls, vertices and chunk counts of every frame to a CSV file.
+    int Render_Path(int frames, std::string path, std::function<void()> renderFrame);
+}
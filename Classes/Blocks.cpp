@@ -6,6 +6,7 @@
 #include "json.hpp"
 
 #include "main.h"
+#include "Chunk.h"
 #include "Interface.h"
 
 #include "../BlockScripts/Block_Scripts.h"
@@ -254,11 +255,7 @@ void Process_Block(nlohmann::json::iterator it, Block &block) {
 
             int index = 0;
 
-            std::vector<std::vector<std::pair<glm::vec3, glm::vec3>>> elementData;
-
             for (auto const &texture : element["texCoords"]) {
-                std::vector<std::pair<glm::vec3, glm::vec3>> data;
-
                 int textureID;
                 glm::vec2 texStart(0);
                 glm::vec2 texEnd(1);
@@ -273,20 +270,27 @@ void Process_Block(nlohmann::json::iterator it, Block &block) {
                 }
 
                 for (int i = 0; i < 6; i++) {
-                    data.push_back(std::make_pair(
-                        startPos + (endPos - startPos) * vertices[index][i],
-                        glm::vec3(
-                            texStart + (texEnd - texStart) * tex_coords[index][i],
-                            textureID
-                        )
-                    ));
+                    Extend(block.ModelTriangles, startPos + (endPos - startPos) * vertices[index][i]);
+                    Extend(block.ModelTriangles, texStart + (texEnd - texStart) * tex_coords[index][i]);
+                    block.ModelTriangles.push_back(static_cast<float>(textureID));
+                }
+
+                for (int const &corner : quad_corners[index]) {
+                    Extend(block.ModelQuads, startPos + (endPos - startPos) * vertices[index][corner]);
+                    Extend(block.ModelQuads, texStart + (texEnd - texStart) * tex_coords[index][corner]);
+                    block.ModelQuads.push_back(static_cast<float>(textureID));
+
+                    // Light and ambient occlusion are filled in when meshing.
+                    Extend(block.ModelQuads, 0.0f, 0.0f);
                 }
 
-                elementData.push_back(data);
+                // Faces on the block's boundary can be hidden by the neighbouring block.
+                int axis = index / 2;
+                bool boundary = (index % 2) ? endPos[axis] >= 1.0f : startPos[axis] <= 0.0f;
+                block.ModelCullFaces.push_back(boundary ? index : -1);
+
                 ++index;
             }
-
-            block.CustomData.push_back(elementData);
         }
 
         if (block.Scale == glm::vec3(1)) {
@@ -431,17 +435,12 @@ void Blocks::Mesh(Data &storage, const Block* block, glm::vec3 offset, float sca
     }
 
     else if (block->HasCustomData) {
-        for (auto const &element : block->CustomData) {
-            for (unsigned long i = 0; i < 6; i++) {
-                for (unsigned long j = 0; j < 6; j++) {
-                    Extend(storage, (element[i][j].first + offset) * scale);
-                    Extend(storage, element[i][j].second);
-
-                    for (float const &value : data) {
-                        storage.push_back(value);
-                    }
-                }
-            }
+        auto const &model = block->ModelTriangles;
+
+        for (unsigned long i = 0; i < model.size(); i += 6) {
+            Extend(storage, (glm::vec3(model[i], model[i + 1], model[i + 2]) + offset) * scale);
+            storage.insert(storage.end(), model.begin() + static_cast<long>(i) + 3, model.begin() + static_cast<long>(i) + 6);
+            storage.insert(storage.end(), data.begin(), data.end());
         }
     }
     else {
@@ -64,7 +64,14 @@ struct Block {
 
     std::vector<int> Textures = {};
 
-    std::vector<std::vector<std::vector<std::pair<glm::vec3, glm::vec3>>>> CustomData = {};
+    // Custom models from "elements", compiled when the block is loaded.
+    // ModelQuads holds four vertices per face in the chunk vertex format, relative to the block.
+    // ModelCullFaces holds the side each quad lies flush against, or -1 for inner quads.
+    std::vector<float> ModelQuads = {};
+    std::vector<int> ModelCullFaces = {};
+
+    // Two triangles per face with position and texture coordinates, for item and icon meshes.
+    std::vector<float> ModelTriangles = {};
 
     std::map<int, Block> Types = {};
 };
@@ -2,8 +2,73 @@
 
 #include "Shader.h"
 
+#include <cstring>
+#include <algorithm>
+
 static const int FLOAT_SIZE = static_cast<int>(sizeof(float));
 
+// Enough quads for a chunk of alternating full blocks, which is the worst case for regular meshes.
+static const int QUAD_PREALLOCATION = 16 * 16 * 16 * 3;
+
+// Arena blocks are rounded up to this many vertices, which keeps them aligned to quads
+// and lets meshes grow a bit without being moved.
+static const int ARENA_ALIGNMENT = 64;
+
+// Size of the arena's staging ring, which should fit a frame's worth of uploads.
+static const long STAGING_SIZE = 4 << 20;
+
+// Every quad is drawn as the two triangles 0-1-2 and 2-3-0.
+static const unsigned int QUAD_INDICES[6] = {0, 1, 2, 2, 3, 0};
+
+// The index buffer shared by all quad buffers, and how many quads it can index.
+static unsigned int QuadEBO = 0;
+static int QuadCapacity = 0;
+
+// Vertex arrays are left bound after drawing, so binding the same one again is skipped.
+static unsigned int BoundVAO = 0;
+
+static void Bind_Vertex_Array(unsigned int vao) {
+    if (vao != BoundVAO) {
+        glBindVertexArray(vao);
+        BoundVAO = vao;
+        ++DrawStateCalls;
+    }
+}
+
+static void Reserve_Quads(int quads) {
+    if (quads <= QuadCapacity) {
+        return;
+    }
+
+    QuadCapacity = std::max(quads, QuadCapacity * 2);
+
+    std::vector<unsigned int> indices;
+    indices.reserve(static_cast<unsigned long>(QuadCapacity) * 6);
+
+    for (unsigned int quad = 0; quad < static_cast<unsigned int>(QuadCapacity); ++quad) {
+        for (unsigned int const &index : QUAD_INDICES) {
+            indices.push_back(quad * 4 + index);
+        }
+    }
+
+    // Make sure no vertex array picks up the binding.
+    Bind_Vertex_Array(0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, QuadEBO);
+    glBufferData(
+        GL_ELEMENT_ARRAY_BUFFER, static_cast<long>(indices.size() * sizeof(unsigned int)),
+        indices.data(), GL_STATIC_DRAW
+    );
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+static void Create_Quad_Indices() {
+    if (QuadEBO == 0) {
+        glGenBuffers(1, &QuadEBO);
+        Reserve_Quads(QUAD_PREALLOCATION);
+    }
+}
+
 void Buffer::Init(Shader *shader) {
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
@@ -12,6 +77,17 @@ void Buffer::Init(Shader *shader) {
     BufferShader = shader;
 }
 
+void Buffer::Index_Quads() {
+    Create_Quad_Indices();
+
+    // The element buffer binding is stored in the vertex array.
+    Bind_Vertex_Array(VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, QuadEBO);
+    Bind_Vertex_Array(0);
+
+    Indexed = true;
+}
+
 void Buffer::Create(const std::vector<int> &config, const Data &data) {
     VertexSize = 0;
 
@@ -19,7 +95,9 @@ void Buffer::Create(const std::vector<int> &config, const Data &data) {
         VertexSize += static_cast<unsigned int>(element);
     }
 
-    glBindVertexArray(VAO);
+    Attributes = static_cast<int>(config.size());
+
+    Bind_Vertex_Array(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
     if (data.size() > 0) {
@@ -42,7 +120,7 @@ void Buffer::Create(const std::vector<int> &config, const Data &data) {
     }
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    Bind_Vertex_Array(0);
 }
 
 void Buffer::Upload(const Data &data, int start, bool sub) {
@@ -54,6 +132,11 @@ void Buffer::Upload(const Data &data, int start, bool sub) {
 
     if (start == 0 && !sub) {
         Vertices = static_cast<int>(data.size()) / VertexSize;
+
+        if (Indexed) {
+            Reserve_Quads(Vertices / 4);
+        }
+
         glBufferData(
             GL_ARRAY_BUFFER, static_cast<long>(data.size() * sizeof(float)),
             data.data(), GL_STATIC_DRAW
@@ -69,6 +152,43 @@ void Buffer::Upload(const Data &data, int start, bool sub) {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
+void Buffer::Create_Instances(const std::vector<int> &config) {
+    InstanceSize = 0;
+
+    for (int const &element : config) {
+        InstanceSize += element;
+    }
+
+    glGenBuffers(1, &InstanceVBO);
+
+    Bind_Vertex_Array(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, InstanceVBO);
+
+    unsigned int index = static_cast<unsigned int>(Attributes);
+    long long partSum = 0;
+
+    for (int const &element : config) {
+        glEnableVertexAttribArray(index);
+        glVertexAttribPointer(index, element, GL_FLOAT, false, InstanceSize * FLOAT_SIZE, reinterpret_cast<const GLvoid*>(partSum * FLOAT_SIZE));
+        glVertexAttribDivisor(index, 1);
+
+        partSum += element;
+        ++index;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    Bind_Vertex_Array(0);
+}
+
+void Buffer::Upload_Instances(const Data &data) {
+    Instances = static_cast<int>(data.size()) / InstanceSize;
+
+    // Orphan the last frame's instances rather than waiting for them to be drawn.
+    glBindBuffer(GL_ARRAY_BUFFER, InstanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<long>(data.size() * sizeof(float)), data.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void Buffer::Draw(int start, int length) {
     if (Vertices == 0) {
         return;
@@ -78,27 +198,256 @@ void Buffer::Draw(int start, int length) {
         length = Vertices;
     }
 
+    if (InstanceVBO != 0) {
+        if (Instances == 0) {
+            return;
+        }
+
+        BufferShader->Bind();
+        Bind_Vertex_Array(VAO);
+
+        if (Indexed) {
+            glDrawElementsInstanced(
+                GL_TRIANGLES, length / 4 * 6, GL_UNSIGNED_INT,
+                reinterpret_cast<const GLvoid*>(start / 4 * 6 * sizeof(unsigned int)), Instances
+            );
+        }
+        else {
+            glDrawArraysInstanced(static_cast<unsigned int>(VertexType), start, length, Instances);
+        }
+
+        ++DrawStateCalls;
+        return;
+    }
+
     BufferShader->Bind();
+    Bind_Vertex_Array(VAO);
 
-    glBindVertexArray(VAO);
-    glDrawArrays(static_cast<unsigned int>(VertexType), start, length);
-    glBindVertexArray(0);
+    if (Indexed) {
+        glDrawElements(
+            GL_TRIANGLES, length / 4 * 6, GL_UNSIGNED_INT,
+            reinterpret_cast<const GLvoid*>(start / 4 * 6 * sizeof(unsigned int))
+        );
+    }
+    else {
+        glDrawArrays(static_cast<unsigned int>(VertexType), start, length);
+    }
 
-    BufferShader->Unbind();
+    ++DrawStateCalls;
 }
 
-float* Buffer::Get_Pointer(int offset, int length) {
+void ArenaBuffer::Init(Shader *shader, const std::vector<int> &config, int capacity) {
+    BufferShader = shader;
+    Config = config;
+
+    VertexSize = 0;
+
+    for (int const &element : config) {
+        VertexSize += element;
+    }
+
+    Create_Quad_Indices();
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &StagingVBO);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, StagingVBO);
+    glBufferData(GL_COPY_READ_BUFFER, STAGING_SIZE, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    Capacity = (capacity + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    FreeBlocks[0] = Capacity;
+
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    float* texPointer = static_cast<float*>(glMapBufferRange(GL_ARRAY_BUFFER, offset * sizeof(float), length * sizeof(float), GL_MAP_WRITE_BIT));
+    glBufferData(GL_ARRAY_BUFFER, static_cast<long>(Capacity) * VertexSize * FLOAT_SIZE, nullptr, GL_STATIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    return texPointer;
+    Bind_Attributes();
+
+    Bind_Vertex_Array(VAO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, QuadEBO);
+    Bind_Vertex_Array(0);
 }
 
-void Buffer::Unbind_Pointer() {
+void ArenaBuffer::Bind_Attributes() {
+    Bind_Vertex_Array(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    unsigned int index = 0;
+    long long partSum = 0;
+
+    for (int const &element : Config) {
+        glEnableVertexAttribArray(index);
+        glVertexAttribPointer(index, element, GL_FLOAT, false, VertexSize * FLOAT_SIZE, reinterpret_cast<const GLvoid*>(partSum * FLOAT_SIZE));
+
+        partSum += element;
+        ++index;
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    Bind_Vertex_Array(0);
+}
+
+int ArenaBuffer::Allocate(int vertices) {
+    int size = (std::max(vertices, 1) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+
+    for (auto const &block : FreeBlocks) {
+        if (block.second < size) {
+            continue;
+        }
+
+        int start = block.first;
+        int remainder = block.second - size;
+
+        FreeBlocks.erase(start);
+
+        if (remainder > 0) {
+            FreeBlocks[start + size] = remainder;
+        }
+
+        Allocations[start] = size;
+        return start;
+    }
+
+    Grow(size);
+    return Allocate(vertices);
+}
+
+void ArenaBuffer::Free(int start) {
+    auto allocation = Allocations.find(start);
+
+    if (allocation == Allocations.end()) {
+        return;
+    }
+
+    int size = allocation->second;
+    Allocations.erase(allocation);
+
+    // Merge the block with the free blocks on either side of it.
+    auto next = FreeBlocks.find(start + size);
+
+    if (next != FreeBlocks.end()) {
+        size += next->second;
+        FreeBlocks.erase(next);
+    }
+
+    auto previous = FreeBlocks.lower_bound(start);
+
+    if (previous != FreeBlocks.begin()) {
+        --previous;
+
+        if (previous->first + previous->second == start) {
+            previous->second += size;
+            return;
+        }
+    }
+
+    FreeBlocks[start] = size;
+}
+
+int ArenaBuffer::Get_Size(int start) {
+    auto allocation = Allocations.find(start);
+    return allocation == Allocations.end() ? 0 : allocation->second;
+}
+
+void ArenaBuffer::Grow(int vertices) {
+    int oldCapacity = Capacity;
+    Capacity = std::max(Capacity * 2, Capacity + vertices);
+
+    unsigned int newVBO;
+    glGenBuffers(1, &newVBO);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newVBO);
+    glBufferData(GL_COPY_WRITE_BUFFER, static_cast<long>(Capacity) * VertexSize * FLOAT_SIZE, nullptr, GL_STATIC_DRAW);
+
+    // Allocations keep their positions, so only the new space is added as a free block.
+    glBindBuffer(GL_COPY_READ_BUFFER, VBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<long>(oldCapacity) * VertexSize * FLOAT_SIZE);
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    glDeleteBuffers(1, &VBO);
+    VBO = newVBO;
+
+    Bind_Attributes();
+
+    Allocations[oldCapacity] = Capacity - oldCapacity;
+    Free(oldCapacity);
+}
+
+void ArenaBuffer::Upload(int start, const Data &data, int offset) {
+    if (data.empty()) {
+        return;
+    }
+
+    int vertices = static_cast<int>(data.size()) / VertexSize;
+    Reserve_Quads((offset + vertices) / 4);
+
+    long size = static_cast<long>(data.size() * sizeof(float));
+    long destination = static_cast<long>(start + offset) * VertexSize * FLOAT_SIZE;
+
+    if (size > STAGING_SIZE) {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, destination, size, data.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, StagingVBO);
+
+    // The ring only ever writes past earlier uploads, so mapping doesn't need to wait for the GPU.
+    // When it wraps around, the buffer is orphaned instead of reusing storage that may still be read.
+    if (StagingOffset + size > STAGING_SIZE) {
+        glBufferData(GL_COPY_READ_BUFFER, STAGING_SIZE, nullptr, GL_STREAM_DRAW);
+        StagingOffset = 0;
+    }
+
+    void* staging = glMapBufferRange(
+        GL_COPY_READ_BUFFER, StagingOffset, size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+    );
+
+    std::memcpy(staging, data.data(), static_cast<unsigned long>(size));
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, StagingOffset, destination, size);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    StagingOffset += size;
+}
+
+void ArenaBuffer::Queue(int start, int offset, int length) {
+    DrawnVertices += length;
+
+    Counts.push_back(length / 4 * 6);
+    Offsets.push_back(reinterpret_cast<void*>(static_cast<unsigned long>(offset / 4 * 6) * sizeof(unsigned int)));
+    BaseVertices.push_back(start);
+}
+
+void ArenaBuffer::Draw() {
+    if (Counts.empty()) {
+        return;
+    }
+
+    BufferShader->Bind();
+    Bind_Vertex_Array(VAO);
+
+    glMultiDrawElementsBaseVertex(
+        GL_TRIANGLES, Counts.data(), GL_UNSIGNED_INT,
+        Offsets.data(), static_cast<int>(Counts.size()), BaseVertices.data()
+    );
+
+    ++DrawCalls;
+    ++DrawStateCalls;
+
+    Counts.clear();
+    Offsets.clear();
+    BaseVertices.clear();
 }
 
 void UniformBuffer::Create(std::string name, unsigned int bufferID, int size, std::vector<Shader*> shaders) {
@@ -15,6 +15,9 @@ class Buffer {
     int VertexType;
     int Vertices = 0;
 
+    // If the vertices are drawn as quads through the shared quad index buffer.
+    bool Indexed = false;
+
     Shader* BufferShader;
 
     inline void Create(const int &a, const Data &data = Data {}) { Create(std::vector<int> {a}, data); }
@@ -24,21 +27,78 @@ class Buffer {
     inline void Create(const int &a, const int &b, const int &c, const int &d, const int &e, const Data &data = Data {}) {Create(std::vector<int> {a, b, c, d, e}, data);}
 
     void Init(Shader *shader);
+    void Index_Quads();
     void Upload(const Data &data, int start = 0, bool sub = false);
     void Draw(int start = 0, int length = 0);
 
-    float* Get_Pointer(int offset, int length);
-    void Unbind_Pointer();
+    // Adds per-instance attributes after the vertex attributes, and draws the mesh once per uploaded instance.
+    void Create_Instances(const std::vector<int> &config);
+    void Upload_Instances(const Data &data);
+
+    inline unsigned int Get_VAO() const { return VAO; }
 
   private:
     unsigned int VAO;
     unsigned int VBO;
+    unsigned int InstanceVBO = 0;
 
     int VertexSize;
+    int Attributes = 0;
+
+    int InstanceSize = 0;
+    int Instances = 0;
 
     void Create(const std::vector<int> &config, const Data &data = Data {});
 };
 
+// A single vertex buffer that many meshes are suballocated from,
+// so that all of them can be drawn as quads with one call.
+class ArenaBuffer {
+  public:
+    Shader* BufferShader;
+
+    // Draw calls and vertices drawn since they were last reset.
+    int DrawCalls = 0;
+    int DrawnVertices = 0;
+
+    void Init(Shader *shader, const std::vector<int> &config, int capacity);
+
+    // Returns the first vertex of a free block of at least the given size, growing the buffer if needed.
+    int Allocate(int vertices);
+    void Free(int start);
+    int Get_Size(int start);
+
+    void Upload(int start, const Data &data, int offset = 0);
+
+    // Queues a range of vertices in a block, and draws every queued range at once.
+    void Queue(int start, int offset, int length);
+    void Draw();
+
+  private:
+    unsigned int VAO;
+    unsigned int VBO;
+
+    // Uploads are written into a staging ring, and copied into the arena on the GPU.
+    unsigned int StagingVBO;
+    long StagingOffset = 0;
+
+    int VertexSize = 0;
+    int Capacity = 0;
+
+    std::vector<int> Config;
+
+    // Block sizes, by their first vertex.
+    std::map<int, int> FreeBlocks;
+    std::map<int, int> Allocations;
+
+    std::vector<int> Counts;
+    std::vector<void*> Offsets;
+    std::vector<int> BaseVertices;
+
+    void Grow(int vertices);
+    void Bind_Attributes();
+};
+
 class UniformBuffer {
   public:
     void Create(std::string name, unsigned int bufferID, int size, std::vector<Shader*> shaders);
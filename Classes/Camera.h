@@ -22,6 +22,9 @@ class Camera {
     float Pitch = 0.0f;
     float Zoom = DEFAULT_FOV;
 
+    // The projection matrix uploaded to the shaders.
+    glm::mat4 Projection;
+
     Camera();
 
     inline glm::mat4 GetViewMatrix() { return glm::lookAt(Position, Position + Front, Up); }
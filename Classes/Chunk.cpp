@@ -2,19 +2,32 @@
 
 #include <chrono>
 #include <random>
+#include <algorithm>
 #include <fstream>
+#include <unordered_set>
+#include <condition_variable>
 
 #include <json.hpp>
 #include <dirent.h>
 #include <noise/noise.h>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+    #define CULL_SSE
+    #include <xmmintrin.h>
+#endif
+
 #include "main.h"
 #include "Blocks.h"
+#include "Camera.h"
 #include "Worlds.h"
 #include "Interface.h"
+#include "ChunkCache.h"
 
 static const glm::dvec2 TREE_NOISE_THRESHOLD = glm::dvec2(0.7, 0.8);
 
+// Time in seconds the meshing thread may spend on remeshes each frame.
+static const double REMESH_BUDGET = 0.004;
+
 struct Structure {
     glm::ivec3 Size = {0, 0, 0};
     std::map<glm::ivec3, std::pair<int, int>, VectorComparator> Blocks = {};
@@ -72,7 +85,7 @@ const std::map<int, glm::dvec2> OreRanges = {
     {2, { 1.20,  1.30}}, // Iron Ore
 };
 
-static const glm::vec3 AOOffsets[6][2][2][3]={
+static const glm::ivec3 AOOffsets[6][2][2][3]={
     {{{{-1,-1,0},{-1,0,-1},{-1,-1,-1}},{{-1,1,0},{-1,0,-1},{-1,1,-1}}},
     {{{-1,-1,0},{-1,0,1},{-1,-1,1}},{{-1,1,0},{-1,0,1},{-1,1,1}}}},
     {{{{1,-1,0},{1,0,-1},{1,-1,-1}},{{1,1,0},{1,0,-1},{1,1,-1}}},
@@ -87,6 +100,29 @@ static const glm::vec3 AOOffsets[6][2][2][3]={
     {{{0,-1,1},{1,0,1},{1,-1,1}},{{0,1,1},{1,0,1},{1,1,1}}}}
 };
 
+// A copy of a chunk's blocks padded with a one block border from its neighbours,
+// so that meshing never has to look anything up in the chunk map.
+struct MeshSnapshot {
+    static const int SIZE = CHUNK_SIZE + 2;
+
+    std::vector<int> Types;
+    std::vector<int> Data;
+    std::vector<unsigned char> Light;
+    std::vector<unsigned char> SeesAir;
+    std::vector<bool> Opaque;
+
+    MeshSnapshot() :
+        Types(SIZE * SIZE * SIZE, 0), Data(SIZE * SIZE * SIZE, 0),
+        Light(SIZE * SIZE * SIZE, 0), SeesAir(SIZE * SIZE * SIZE, 0),
+        Opaque(SIZE * SIZE * SIZE, false) {}
+
+    // Tiles range from -1 to CHUNK_SIZE.
+    inline unsigned long Index(glm::ivec3 tile) const {
+        tile += 1;
+        return static_cast<unsigned long>((tile.x * SIZE + tile.y) * SIZE + tile.z);
+    }
+};
+
 static noise::module::RidgedMulti ridgedNoise;
 static noise::module::RidgedMulti oreNoise;
 static noise::module::Perlin noiseModule;
@@ -108,6 +144,34 @@ std::map<
 
 static std::mt19937_64 rng;
 
+static std::mutex WorkMutex;
+static std::condition_variable WorkCondition;
+static bool WorkPending = false;
+
+static std::mutex RemeshMutex;
+static std::set<glm::vec3, ChunkPosComparator> PendingRemeshes;
+static std::set<glm::vec3, ChunkPosComparator> RemeshBatch;
+
+// Enough vertices for a few hundred average chunks, the arena grows past that when needed.
+static const int ARENA_CAPACITY = 1 << 20;
+
+static ArenaBuffer Arena;
+
+// Bytes of new chunk meshes uploaded per frame.
+static const long UPLOAD_BUDGET = 1 << 20;
+
+static int FrustumChunks = 0;
+static int DrawnChunks = 0;
+
+// The visible chunks nearest first, and the squared distances and counts used to sort them.
+static std::vector<Chunk*> SortedChunks;
+static std::vector<std::pair<int, Chunk*>> VisibleChunks;
+static std::vector<int> DistanceCounts;
+
+static int RemeshRequests = 0;
+static int CoalescedRemeshes = 0;
+static int ExecutedRemeshes = 0;
+
 static nlohmann::json Parse_JSON(std::string path) {
     std::stringstream file_content;
     nlohmann::json json;
@@ -212,6 +276,363 @@ void Chunks::Delete(glm::vec3 chunk) {
 	ChunkMapBusy.clear(std::memory_order_release);
 }
 
+void Chunks::Init_Arena(Shader* chunkShader) {
+    Arena.Init(chunkShader, {3, 3, 1, 1}, ARENA_CAPACITY);
+}
+
+void Chunks::Draw(bool transparentPass) {
+    if (!transparentPass) {
+        // Upload new meshes under a budget, so that many chunks finishing at once don't stall a frame.
+        // Visible chunks go first, nearest first, and at least one mesh is uploaded every frame.
+        long uploaded = 0;
+
+        for (auto const &chunk : SortedChunks) {
+            if (uploaded >= UPLOAD_BUDGET) {
+                break;
+            }
+
+            uploaded += chunk->Upload();
+        }
+
+        for (auto const &chunk : ChunkMap) {
+            if (uploaded >= UPLOAD_BUDGET) {
+                break;
+            }
+
+            uploaded += chunk.second->Upload();
+        }
+
+        for (auto const &chunk : SortedChunks) {
+            chunk->Draw();
+        }
+    }
+    else {
+        for (auto chunk = SortedChunks.rbegin(); chunk != SortedChunks.rend(); ++chunk) {
+            (*chunk)->Draw(true);
+        }
+    }
+
+    Arena.Draw();
+}
+
+int Chunks::Get_Draw_Calls() {
+    return Arena.DrawCalls;
+}
+
+int Chunks::Get_Drawn_Vertices() {
+    return Arena.DrawnVertices;
+}
+
+void Chunks::Notify_Work() {
+    {
+        std::lock_guard<std::mutex> lock(WorkMutex);
+        WorkPending = true;
+    }
+
+    WorkCondition.notify_one();
+}
+
+void Chunks::Wait_For_Work(int milliseconds) {
+    std::unique_lock<std::mutex> lock(WorkMutex);
+    WorkCondition.wait_for(lock, std::chrono::milliseconds(milliseconds), [] { return WorkPending; });
+    WorkPending = false;
+}
+
+void Chunks::Request_Remesh(Chunk* chunk, int sections) {
+    chunk->DirtySections |= sections;
+
+    // Chunks that haven't been meshed yet get all of their sections meshed anyway.
+    if (!chunk->Meshed) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(RemeshMutex);
+    ++RemeshRequests;
+
+    if (!PendingRemeshes.insert(chunk->Position).second) {
+        ++CoalescedRemeshes;
+    }
+}
+
+void Chunks::Schedule_Remeshes() {
+    {
+        std::lock_guard<std::mutex> lock(RemeshMutex);
+
+        if (PendingRemeshes.empty()) {
+            return;
+        }
+
+        RemeshBatch.insert(PendingRemeshes.begin(), PendingRemeshes.end());
+        PendingRemeshes.clear();
+    }
+
+    Notify_Work();
+}
+
+bool Chunks::Receive_Changes(Chunk* chunk) {
+    if (!chunk->Loaded && Worlds::Receive_Chunk(WORLD_NAME, chunk->Position)) {
+        chunk->ChangesHash = ChunkCache::Hash_Changes(chunk->Position);
+        chunk->Loaded = true;
+    }
+
+    return chunk->Loaded;
+}
+
+void Chunks::Receive_Loads() {
+    // The background thread reads ChangedBlocks while it holds the chunk map, so try again next frame if it's busy.
+    if (ChunkMapBusy.test_and_set(std::memory_order_acquire)) {
+        return;
+    }
+
+    for (auto const &chunk : ChunkMap) {
+        Receive_Changes(chunk.second);
+    }
+
+    ChunkMapBusy.clear(std::memory_order_release);
+}
+
+void Chunks::Process_Remeshes() {
+    std::set<glm::vec3, ChunkPosComparator> batch;
+
+    {
+        std::lock_guard<std::mutex> lock(RemeshMutex);
+        batch.swap(RemeshBatch);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto it = batch.begin();
+
+    while (it != batch.end()) {
+        if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= REMESH_BUDGET) {
+            break;
+        }
+
+        auto chunk = ChunkMap.find(*it);
+
+        if (chunk != ChunkMap.end() && chunk->second->Meshed && chunk->second->DirtySections != 0) {
+            chunk->second->Mesh();
+
+            std::lock_guard<std::mutex> lock(RemeshMutex);
+            ++ExecutedRemeshes;
+        }
+
+        it = batch.erase(it);
+    }
+
+    // Whatever didn't fit in the budget is scheduled again next frame.
+    if (!batch.empty()) {
+        std::lock_guard<std::mutex> lock(RemeshMutex);
+        PendingRemeshes.insert(batch.begin(), batch.end());
+    }
+}
+
+int Chunks::Get_LOD(float distance) {
+    int lod = 0;
+
+    while (lod < LOD_LEVELS - 1 && distance >= LOD_DISTANCES[lod]) {
+        ++lod;
+    }
+
+    return lod;
+}
+
+// Returns a bit per section of the chunk at the world position which is at least partly
+// in front of every frustum plane.
+static int Cull_Sections(const glm::vec4 (&planes)[6], glm::vec3 origin) {
+#ifdef CULL_SSE
+    static_assert(CHUNK_SECTIONS == 4, "The sections of a chunk are tested in one batch.");
+
+    // The boxes of all sections share their X and Z extents, so only Y differs between the lanes.
+    __m128 minY = _mm_add_ps(
+        _mm_set1_ps(origin.y),
+        _mm_setr_ps(0.0f, SECTION_HEIGHT, 2.0f * SECTION_HEIGHT, 3.0f * SECTION_HEIGHT)
+    );
+    __m128 maxY = _mm_add_ps(minY, _mm_set1_ps(SECTION_HEIGHT));
+    __m128 zero = _mm_setzero_ps();
+    __m128 inside = _mm_cmpeq_ps(zero, zero);
+
+    for (auto const &plane : planes) {
+        // Test the corner furthest along the plane normal.
+        float x = (plane.x > 0) ? origin.x + CHUNK_SIZE : origin.x;
+        float z = (plane.z > 0) ? origin.z + CHUNK_SIZE : origin.z;
+        __m128 y = (plane.y > 0) ? maxY : minY;
+
+        __m128 dist = _mm_add_ps(
+            _mm_mul_ps(_mm_set1_ps(plane.y), y),
+            _mm_set1_ps(plane.x * x + plane.z * z + plane.w)
+        );
+
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, zero));
+    }
+
+    return _mm_movemask_ps(inside);
+#else
+    int visible = 0;
+
+    for (int section = 0; section < CHUNK_SECTIONS; ++section) {
+        glm::vec3 min = origin + glm::vec3(0, section * SECTION_HEIGHT, 0);
+        glm::vec3 max = min + glm::vec3(CHUNK_SIZE, SECTION_HEIGHT, CHUNK_SIZE);
+        bool inside = true;
+
+        for (auto const &plane : planes) {
+            glm::vec3 corner = glm::mix(min, max, glm::greaterThan(plane.xyz(), glm::vec3(0)));
+
+            if (glm::dot(plane.xyz(), corner) + plane.w < 0) {
+                inside = false;
+                break;
+            }
+        }
+
+        if (inside) {
+            visible |= 1 << section;
+        }
+    }
+
+    return visible;
+#endif
+}
+
+// The bit of a pair of faces in a chunk's face connections.
+static int Face_Pair(int a, int b) {
+    if (a > b) {
+        std::swap(a, b);
+    }
+
+    return 1 << (a * 6 - a * (a + 1) / 2 + (b - a - 1));
+}
+
+static glm::ivec3 Face_Normal(int face) {
+    glm::ivec3 normal(0);
+    normal[face / 2] = (face % 2) ? 1 : -1;
+    return normal;
+}
+
+// Walks outwards from the camera's chunk, never turning back, and only leaves a chunk
+// through faces that are connected to the one it was entered through.
+// Visible chunks that aren't reached are hidden.
+static void Cull_Caves(glm::vec3 cameraChunk) {
+    auto start = ChunkMap.find(cameraChunk);
+
+    if (start == ChunkMap.end()) {
+        return;
+    }
+
+    struct Step {
+        Chunk* chunk;
+        int from;
+        int directions;
+    };
+
+    std::unordered_set<Chunk*> reached = {start->second};
+    std::queue<Step> steps;
+    steps.push({start->second, -1, 0});
+
+    while (!steps.empty()) {
+        Step step = steps.front();
+        steps.pop();
+
+        for (int face = 0; face < 6; ++face) {
+            if (step.directions & (1 << (face ^ 1))) {
+                continue;
+            }
+
+            if (step.from != -1 && !(step.chunk->FaceConnections & Face_Pair(step.from, face))) {
+                continue;
+            }
+
+            auto neighbor = ChunkMap.find(step.chunk->Position + glm::vec3(Face_Normal(face)));
+
+            if (neighbor == ChunkMap.end() || !neighbor->second->Visible || reached.count(neighbor->second)) {
+                continue;
+            }
+
+            reached.insert(neighbor->second);
+            steps.push({neighbor->second, face ^ 1, step.directions | (1 << face)});
+        }
+    }
+
+    for (auto const &chunk : ChunkMap) {
+        if (chunk.second->Visible && !reached.count(chunk.second)) {
+            chunk.second->Visible = false;
+        }
+    }
+}
+
+// Sorts the visible chunks by their squared distance in chunks from the camera's chunk.
+// The distances are small integers, so a counting sort does it in linear time.
+static void Sort_Visible(glm::vec3 cameraChunk) {
+    VisibleChunks.clear();
+    int maxDistance = 0;
+
+    for (auto const &chunk : ChunkMap) {
+        if (!chunk.second->Visible) {
+            continue;
+        }
+
+        glm::ivec3 diff = glm::ivec3(chunk.first - cameraChunk);
+        int distance = diff.x * diff.x + diff.y * diff.y + diff.z * diff.z;
+
+        VisibleChunks.emplace_back(distance, chunk.second);
+        maxDistance = std::max(maxDistance, distance);
+    }
+
+    DistanceCounts.assign(static_cast<unsigned long>(maxDistance) + 2, 0);
+
+    for (auto const &entry : VisibleChunks) {
+        ++DistanceCounts[static_cast<unsigned long>(entry.first) + 1];
+    }
+
+    for (unsigned long i = 1; i < DistanceCounts.size(); ++i) {
+        DistanceCounts[i] += DistanceCounts[i - 1];
+    }
+
+    SortedChunks.resize(VisibleChunks.size());
+
+    for (auto const &entry : VisibleChunks) {
+        int &index = DistanceCounts[static_cast<unsigned long>(entry.first)];
+        SortedChunks[static_cast<unsigned long>(index++)] = entry.second;
+    }
+}
+
+void Chunks::Cull(glm::mat4 viewProjection, glm::vec3 cameraPos) {
+    glm::mat4 m = glm::transpose(viewProjection);
+
+    // Left, right, bottom, top, near and far planes.
+    glm::vec4 planes[6] = {
+        m[3] + m[0], m[3] - m[0],
+        m[3] + m[1], m[3] - m[1],
+        m[3] + m[2], m[3] - m[2]
+    };
+
+    Arena.DrawCalls = 0;
+    Arena.DrawnVertices = 0;
+    FrustumChunks = 0;
+
+    for (auto const &chunk : ChunkMap) {
+        int visible = Cull_Sections(planes, chunk.first * static_cast<float>(CHUNK_SIZE));
+
+        chunk.second->VisibleSections = visible;
+        chunk.second->Visible = visible != 0;
+        FrustumChunks += visible != 0;
+    }
+
+    glm::vec3 cameraChunk = glm::floor(cameraPos / static_cast<float>(CHUNK_SIZE));
+
+    Cull_Caves(cameraChunk);
+    Sort_Visible(cameraChunk);
+
+    DrawnChunks = static_cast<int>(SortedChunks.size());
+}
+
+std::tuple<int, int> Chunks::Get_Cull_Stats() {
+    return std::make_tuple(FrustumChunks, DrawnChunks);
+}
+
+std::tuple<int, int, int> Chunks::Get_Remesh_Stats() {
+    std::lock_guard<std::mutex> lock(RemeshMutex);
+    return std::make_tuple(RemeshRequests, CoalescedRemeshes, ExecutedRemeshes);
+}
+
 void Chunk::Update_Air(glm::ivec3 pos, glm::bvec3 inChunk) {
     bool chunkTests[3] = { inChunk.y && inChunk.z, inChunk.x && inChunk.z, inChunk.x && inChunk.y };
     static glm::ivec3 offsets[3] = { {1, 0, 0}, {0, 1, 0}, {0, 0, 1} };
@@ -303,7 +724,6 @@ void Chunk::Generate_Block(glm::ivec3 pos) {
         const Block* blockInstance = Blocks::Get_Block(type, data);
 
         if (!blockInstance->FullBlock || blockInstance->Transparent) {
-            ContainsTransparentBlocks = true;
             Update_Air(pos, inChunk);
         }
 
@@ -312,7 +732,6 @@ void Chunk::Generate_Block(glm::ivec3 pos) {
             Update_Transparency(pos);
         }
 
-        Blocks.insert(pos);
         return;
     }
 
@@ -353,8 +772,12 @@ void Chunk::Generate_Block(glm::ivec3 pos) {
             Set_Type(pos, 3);
         }
     }
+}
 
-    Blocks.insert(pos);
+Chunk::~Chunk() {
+    if (ArenaStart != -1) {
+        Arena.Free(ArenaStart);
+    }
 }
 
 void Chunk::Generate() {    
@@ -381,6 +804,109 @@ void Chunk::Generate() {
     Generated = true;
 }
 
+void Chunk::Save_State(ChunkSnapshot &snapshot) {
+    std::map<std::pair<int, int>, unsigned short> paletteIndices;
+
+    snapshot.Blocks.resize(CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE);
+    snapshot.Light.resize(CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE);
+    snapshot.Air.resize(CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE);
+    snapshot.Tops.resize(CHUNK_SIZE * CHUNK_SIZE, NO_TOP);
+
+    int index = 0;
+
+    for (int x = 0; x < CHUNK_SIZE; ++x) {
+        for (int y = 0; y < CHUNK_SIZE; ++y) {
+            for (int z = 0; z < CHUNK_SIZE; ++z, ++index) {
+                std::pair<int, int> block(BlockMap[x][y][z], DataMap[x][y][z]);
+                auto paletteIndex = paletteIndices.find(block);
+
+                if (paletteIndex == paletteIndices.end()) {
+                    unsigned short newIndex = static_cast<unsigned short>(snapshot.Palette.size());
+                    paletteIndex = paletteIndices.emplace(block, newIndex).first;
+                    snapshot.Palette.push_back(block);
+                }
+
+                snapshot.Blocks[index] = paletteIndex->second;
+                snapshot.Light[index] = LightMap[x][y][z];
+                snapshot.Air[index] = SeesAir[x][y][z];
+            }
+        }
+    }
+
+    int bottom = static_cast<int>(Position.y) * CHUNK_SIZE;
+
+    for (int x = 0; x < CHUNK_SIZE; ++x) {
+        for (int z = 0; z < CHUNK_SIZE; ++z) {
+            glm::ivec3 tile(x, 0, z);
+
+            if (Top_Exists(tile) && Get_Top(tile) >= bottom && Get_Top(tile) < bottom + CHUNK_SIZE) {
+                snapshot.Tops[x * CHUNK_SIZE + z] = Get_Top(tile);
+            }
+        }
+    }
+}
+
+void Chunk::Restore_State(const ChunkSnapshot &snapshot) {
+    ContainsChangedBlocks = ChangedBlocks.count(Position) > 0;
+
+    if (Position.y == 3) {
+        TopBlocks[Position.xz()].clear();
+    }
+
+    int index = 0;
+
+    for (int x = 0; x < CHUNK_SIZE; ++x) {
+        for (int y = 0; y < CHUNK_SIZE; ++y) {
+            for (int z = 0; z < CHUNK_SIZE; ++z, ++index) {
+                const std::pair<int, int> &block = snapshot.Palette[snapshot.Blocks[index]];
+
+                BlockMap[x][y][z] = block.first;
+                DataMap[x][y][z] = block.second;
+                LightMap[x][y][z] = snapshot.Light[index];
+                SeesAir[x][y][z] = snapshot.Air[index];
+
+                const Block* blockInstance = block.first != 0 ? Blocks::Get_Block(block.first, block.second) : nullptr;
+
+                if (blockInstance != nullptr && blockInstance->Transparent) {
+                    TransparentBlocks.emplace(x, y, z);
+                }
+            }
+        }
+    }
+
+    for (int x = 0; x < CHUNK_SIZE; ++x) {
+        for (int z = 0; z < CHUNK_SIZE; ++z) {
+            glm::ivec3 tile(x, 0, z);
+            int top = snapshot.Tops[x * CHUNK_SIZE + z];
+
+            if (top != NO_TOP && (!Top_Exists(tile) || top > Get_Top(tile))) {
+                Set_Top(tile, top);
+            }
+        }
+    }
+
+    // Neighbors generated since the chunk was unloaded still need to see through its transparent blocks.
+    for (auto const &block : TransparentBlocks) {
+        Update_Transparency(block);
+    }
+
+    // The inside is already lit, so only the light at the edges needs to spread into the neighbors.
+    for (int x = 0; x < CHUNK_SIZE; ++x) {
+        for (int y = 0; y < CHUNK_SIZE; ++y) {
+            for (int z = 0; z < CHUNK_SIZE; ++z) {
+                bool edge = x == 0 || y == 0 || z == 0 ||
+                            x == CHUNK_SIZE - 1 || y == CHUNK_SIZE - 1 || z == CHUNK_SIZE - 1;
+
+                if (edge && LightMap[x][y][z] > 0) {
+                    LightQueue.emplace(Position, glm::vec3(x, y, z));
+                }
+            }
+        }
+    }
+
+    Generated = true;
+}
+
 void Chunk::Generate_Tree(glm::vec3 tile) {
     glm::dvec3 treePos = static_cast<glm::dvec3>(
         Get_World_Pos(Position, tile) / static_cast<float>(CHUNK_ZOOM)
@@ -436,14 +962,13 @@ void Chunk::Generate_Tree(glm::vec3 tile) {
             const Block* blockType = Blocks::Get_Block(block.second.first, block.second.second);
 
             if (!blockType->FullBlock || blockType->Transparent) {
-                ch->ContainsTransparentBlocks = true;
                 ch->Update_Air(tilePos, glm::bvec3(true));
             }
             else {
                 ch->Get_Air_Ref(tilePos) &= ~(1 << DOWN | 1 << UP);
             }
 
-            ch->Blocks.insert(tilePos);
+            Chunks::Request_Remesh(ch, 1 << (tilePos.y / SECTION_HEIGHT));
         }
     }
 }
@@ -459,7 +984,7 @@ bool Check_If_Node(LightNode node) {
     return true;
 }
 
-void Chunk::Light(bool flag) {
+void Chunk::Light() {
     if (UnloadedLightQueue.count(Position)) {
         for (auto node : UnloadedLightQueue[Position]) {
             if (Check_If_Node(node)) {
@@ -507,8 +1032,6 @@ void Chunk::Light(bool flag) {
                 neighborChunk->Set_Light(neighbor.second, neighborLight);
                 neighborChunk->LightQueue.emplace(neighbor.first, neighbor.second);
             }
-
-            neighborChunk->Meshed = false;
         }
     }
 
@@ -536,30 +1059,133 @@ void Chunk::Light(bool flag) {
                 ChunkMap[neighbor.first]->LightQueue.emplace(
                     neighbor.first, neighbor.second
                 );
+            }
+        }
+
+        ++index;
+    }
+}
 
-                if (neighbor.first != Position && flag) {
-                    ChunkMap[neighbor.first]->Meshed = false;
+void Chunk::Take_Snapshot(MeshSnapshot &snapshot) {
+    Chunk* chunks[3][3][3];
+
+    for (int x = 0; x < 3; ++x) {
+        for (int y = 0; y < 3; ++y) {
+            for (int z = 0; z < 3; ++z) {
+                auto it = ChunkMap.find(Position + glm::vec3(x - 1, y - 1, z - 1));
+                bool usable = it != ChunkMap.end() && it->second->Generated;
+                chunks[x][y][z] = usable ? it->second : nullptr;
+            }
+        }
+    }
+
+    chunks[1][1][1] = this;
+
+    for (int x = -1; x <= CHUNK_SIZE; ++x) {
+        for (int y = -1; y <= CHUNK_SIZE; ++y) {
+            for (int z = -1; z <= CHUNK_SIZE; ++z) {
+                glm::ivec3 pos(x, y, z);
+                glm::ivec3 offset = (pos + CHUNK_SIZE) / CHUNK_SIZE;
+                Chunk* chunk = chunks[offset.x][offset.y][offset.z];
+
+                if (chunk == nullptr) {
+                    continue;
+                }
+
+                glm::ivec3 tile = pos - (offset - 1) * CHUNK_SIZE;
+                unsigned long index = snapshot.Index(pos);
+
+                int type = chunk->Get_Type(tile);
+
+                snapshot.Types[index] = type;
+                snapshot.Light[index] = static_cast<unsigned char>(chunk->Get_Light(tile));
+                snapshot.SeesAir[index] = chunk->Get_Air(tile);
+
+                if (type != 0) {
+                    int data = chunk->Get_Data(tile);
+                    const Block* block = Blocks::Get_Block(type, data);
+
+                    snapshot.Data[index] = data;
+                    snapshot.Opaque[index] = block->FullBlock && !block->Transparent;
                 }
             }
         }
+    }
+}
 
-        ++index;
+// Flood fills the air inside the chunk, and returns which pairs of faces the air connects.
+static int Connect_Faces(const MeshSnapshot &snapshot) {
+    std::vector<bool> filled(CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE, false);
+    std::vector<glm::ivec3> stack;
+    int connections = 0;
+
+    auto index = [](glm::ivec3 tile) {
+        return static_cast<unsigned long>((tile.x * CHUNK_SIZE + tile.y) * CHUNK_SIZE + tile.z);
+    };
+
+    for (int x = 0; x < CHUNK_SIZE; ++x) {
+        for (int y = 0; y < CHUNK_SIZE; ++y) {
+            for (int z = 0; z < CHUNK_SIZE; ++z) {
+                glm::ivec3 tile(x, y, z);
+
+                if (filled[index(tile)] || snapshot.Opaque[snapshot.Index(tile)]) {
+                    continue;
+                }
+
+                int faces = 0;
+                filled[index(tile)] = true;
+                stack.push_back(tile);
+
+                while (!stack.empty()) {
+                    glm::ivec3 pos = stack.back();
+                    stack.pop_back();
+
+                    for (int face = 0; face < 6; ++face) {
+                        glm::ivec3 next = pos + Face_Normal(face);
+
+                        if (next[face / 2] < 0 || next[face / 2] >= CHUNK_SIZE) {
+                            faces |= 1 << face;
+                            continue;
+                        }
+
+                        if (filled[index(next)] || snapshot.Opaque[snapshot.Index(next)]) {
+                            continue;
+                        }
+
+                        filled[index(next)] = true;
+                        stack.push_back(next);
+                    }
+                }
+
+                for (int a = 0; a < 6; ++a) {
+                    for (int b = a + 1; b < 6; ++b) {
+                        if ((faces & (1 << a)) && (faces & (1 << b))) {
+                            connections |= Face_Pair(a, b);
+                        }
+                    }
+                }
+            }
+        }
     }
+
+    return connections;
 }
 
-float Chunk::GetAO(glm::vec3 block, int face, int index) {
+float Chunk::GetAO(const MeshSnapshot &snapshot, glm::ivec3 block, int face, int index) {
     float ao = 0.0f;
 
+    glm::vec3 vertex = vertices[face][quad_corners[face][index]];
+
     glm::ivec2 vertexIndexes[3] = {
-        vertices[face][index].zy(),
-        vertices[face][index].xz(),
-        vertices[face][index].xy()
+        vertex.zy(),
+        vertex.xz(),
+        vertex.xy()
     };
 
     for (int i = 0; i < 3; ++i) {
         glm::ivec2 vertexIndex = vertexIndexes[face / 2];
 
-        if (!Blocks.count(block + AOOffsets[face][vertexIndex.x][vertexIndex.y][i])) {
+        if (!snapshot.Opaque[snapshot.Index(block + AOOffsets[face][vertexIndex.x][vertexIndex.y][i])]) {
             continue;
         }
 
@@ -573,141 +1199,472 @@ float Chunk::GetAO(glm::vec3 block, int face, int index) {
     return ao;
 }
 
-void Chunk::Mesh() {
-    VBOData.clear();
-    ExtraOffsets.clear();
+void Chunk::Mesh_Section(const MeshSnapshot &snapshot, int section) {
+    SectionMesh &mesh = Sections[static_cast<unsigned long>(section)];
 
-    auto block = Blocks.begin();
+    mesh.Opaque.clear();
+    mesh.Transparent.clear();
+    mesh.TransparentRanges.clear();
 
-    while (block != Blocks.end()) {
-        unsigned char seesAir = Get_Air(*block);
+    for (int y = section * SECTION_HEIGHT; y < (section + 1) * SECTION_HEIGHT; ++y) {
+        for (int x = 0; x < CHUNK_SIZE; ++x) {
+            for (int z = 0; z < CHUNK_SIZE; ++z) {
+                glm::ivec3 block(x, y, z);
+                unsigned long index = snapshot.Index(block);
 
-        if (seesAir == 0) {
-            block = Blocks.erase(block);
-            continue;
+                int type = snapshot.Types[index];
+                unsigned char seesAir = snapshot.SeesAir[index];
+
+                if (type == 0 || seesAir == 0) {
+                    continue;
+                }
+
+                glm::vec3 posOffset = Get_World_Pos(Position, block);
+                float lightValue = static_cast<float>(snapshot.Light[index]);
+                const Block* blockInstance = Blocks::Get_Block(type, snapshot.Data[index]);
+
+                // Translucent blocks go in their own range, so each pass only draws its own geometry.
+                Data &storage = blockInstance->Transparent ? mesh.Transparent : mesh.Opaque;
+
+                unsigned long start = storage.size();
+
+                if (blockInstance->HasCustomData) {
+                    const int quadSize = 4 * CHUNK_VERTEX_SIZE;
+                    auto quad = blockInstance->ModelQuads.begin();
+
+                    for (int const &face : blockInstance->ModelCullFaces) {
+                        // Skip boundary faces that are covered by an opaque neighbour.
+                        if (face != -1) {
+                            glm::ivec3 normal(0);
+                            normal[face / 2] = (face % 2) ? 1 : -1;
+
+                            if (snapshot.Opaque[snapshot.Index(block + normal)]) {
+                                quad += quadSize;
+                                continue;
+                            }
+                        }
+
+                        unsigned long quadStart = storage.size();
+                        storage.insert(storage.end(), quad, quad + quadSize);
+                        quad += quadSize;
+
+                        for (unsigned long v = quadStart; v < storage.size(); v += CHUNK_VERTEX_SIZE) {
+                            storage[v]     += posOffset.x;
+                            storage[v + 1] += posOffset.y;
+                            storage[v + 2] += posOffset.z;
+                            storage[v + 6]  = lightValue;
+                        }
+                    }
+                }
+                else {
+                    for (int bit = 0; bit < 6; ++bit, seesAir >>= 1) {
+                        if (!(seesAir & 1)) {
+                            continue;
+                        }
+
+                        for (int j = 0; j < 4; j++) {
+                            int corner = quad_corners[bit][j];
+
+                            Extend(storage, vertices[bit][corner] + posOffset);
+
+                            if (blockInstance->MultiTextures) {
+                                Extend(storage, tex_coords[bit][corner]);
+                                storage.push_back(static_cast<float>(blockInstance->Textures[static_cast<unsigned long>(bit)]));
+                            }
+                            else {
+                                Extend(storage, tex_coords[bit][corner]);
+                                storage.push_back(static_cast<float>(blockInstance->Texture));
+                            }
+
+                            storage.push_back(lightValue);
+
+                            if (AMBIENT_OCCLUSION) {
+                                storage.push_back(GetAO(snapshot, block, bit, j));
+                            }
+                            else {
+                                storage.push_back(0);
+                            }
+                        }
+                    }
+                }
+
+                if (blockInstance->Transparent && storage.size() > start) {
+                    mesh.TransparentRanges.emplace_back(block, start, storage.size() - start);
+                }
+            }
         }
+    }
+}
 
-        glm::vec3 posOffset = *block + Position * static_cast<float>(CHUNK_SIZE);
-        float lightValue = static_cast<float>(Get_Light(*block));
-        const Block* blockInstance = Blocks::Get_Block(Get_Type(*block), Get_Data(*block));
+Data Chunk::Mesh_LOD(const MeshSnapshot &snapshot, int lod) {
+    const int factor = 1 << lod;
+    const int cells = CHUNK_SIZE / factor;
 
-        if (blockInstance->HasCustomData) {
-            for (auto const &element : blockInstance->CustomData) {
-                bool extraTextures = false;
+    Data data;
+    std::vector<const Block*> cellBlocks(static_cast<unsigned long>(cells * cells * cells), nullptr);
+    std::vector<float> cellLight(cellBlocks.size(), 0.0f);
 
-                for (unsigned long i = 0; i < 6; i++) {
-                    for (unsigned long j = 0; j < 6; j++) {
-                        Extend(VBOData, element[i][j].first + posOffset);
-                        Extend(VBOData, element[i][j].second);
-                        VBOData.push_back(lightValue);
-                        VBOData.push_back(0);
-                        VBOData.push_back(0);
+    auto cellIndex = [cells](glm::ivec3 cell) {
+        return static_cast<unsigned long>((cell.x * cells + cell.y) * cells + cell.z);
+    };
 
-                        if (!extraTextures) {
-                            extraTextures = true;
-                            ExtraOffsets[*block] = {static_cast<unsigned int>(VBOData.size()) - 1, 6};
+    // A cell is solid if it contains any opaque full block, so that it never leaves holes next to a finer mesh.
+    // Its texture is taken from the most common block, preferring blocks that are exposed to air.
+    // Transparent blocks such as water and glass are left out, since the whole mesh is drawn as opaque.
+    for (int x = 0; x < cells; ++x) {
+        for (int y = 0; y < cells; ++y) {
+            for (int z = 0; z < cells; ++z) {
+                glm::ivec3 cell(x, y, z);
+                std::map<const Block*, int> counts;
+
+                for (int bx = 0; bx < factor; ++bx) {
+                    for (int by = 0; by < factor; ++by) {
+                        for (int bz = 0; bz < factor; ++bz) {
+                            unsigned long index = snapshot.Index(cell * factor + glm::ivec3(bx, by, bz));
+                            int type = snapshot.Types[index];
+
+                            if (type == 0) {
+                                continue;
+                            }
+
+                            const Block* block = Blocks::Get_Block(type, snapshot.Data[index]);
+
+                            if (!block->FullBlock || block->Transparent) {
+                                continue;
+                            }
+
+                            counts[block] += (snapshot.SeesAir[index] != 0) ? factor * factor * factor : 1;
+                            cellLight[cellIndex(cell)] = std::max(cellLight[cellIndex(cell)], static_cast<float>(snapshot.Light[index]));
                         }
                     }
                 }
+
+                int bestCount = 0;
+
+                for (auto const &count : counts) {
+                    if (count.second > bestCount) {
+                        bestCount = count.second;
+                        cellBlocks[cellIndex(cell)] = count.first;
+                    }
+                }
             }
         }
-        else {
-            unsigned int extraOffset = 0;
-            unsigned int extraSides = 0;
+    }
 
-            for (int bit = 0; bit < 6; ++bit, seesAir >>= 1) {
-                if (!(seesAir & 1)) {
+    for (int x = 0; x < cells; ++x) {
+        for (int y = 0; y < cells; ++y) {
+            for (int z = 0; z < cells; ++z) {
+                glm::ivec3 cell(x, y, z);
+                const Block* block = cellBlocks[cellIndex(cell)];
+
+                if (block == nullptr) {
                     continue;
                 }
 
-                for (int j = 0; j < 6; j++) {
-                    Extend(VBOData, vertices[bit][j] + posOffset);
+                glm::vec3 posOffset = Get_World_Pos(Position, cell * factor);
 
-                    if (blockInstance->MultiTextures) {
-                        Extend(VBOData, tex_coords[bit][j]);
-                        VBOData.push_back(static_cast<float>(blockInstance->Textures[static_cast<unsigned long>(bit)]));
-                    }
-                    else {
-                        Extend(VBOData, tex_coords[bit][j]);
-                        VBOData.push_back(static_cast<float>(blockInstance->Texture));
-                    }
+                for (int bit = 0; bit < 6; ++bit) {
+                    int axis = bit / 2;
+                    glm::ivec3 normal(0);
+                    normal[axis] = (bit % 2) ? 1 : -1;
 
-                    VBOData.push_back(lightValue);
+                    glm::ivec3 neighbor = cell + normal;
 
-                    if (AMBIENT_OCCLUSION) {
-                        VBOData.push_back(GetAO(*block, bit, j));
+                    if (neighbor[axis] >= 0 && neighbor[axis] < cells) {
+                        if (cellBlocks[cellIndex(neighbor)] != nullptr) {
+                            continue;
+                        }
                     }
                     else {
-                        VBOData.push_back(0);
+                        // Neighbouring chunks may use another level of detail, so faces on the chunk border
+                        // are only hidden if every block behind them is opaque.
+                        glm::ivec3 origin = cell * factor + ((bit % 2) ? normal * factor : normal);
+                        bool covered = true;
+
+                        for (int u = 0; u < factor && covered; ++u) {
+                            for (int v = 0; v < factor && covered; ++v) {
+                                glm::ivec3 offset(0);
+                                offset[(axis + 1) % 3] = u;
+                                offset[(axis + 2) % 3] = v;
+
+                                covered = snapshot.Opaque[snapshot.Index(origin + offset)];
+                            }
+                        }
+
+                        if (covered) {
+                            continue;
+                        }
                     }
 
-                    VBOData.push_back(0);
+                    float texture = static_cast<float>(
+                        block->MultiTextures ? block->Textures[static_cast<unsigned long>(bit)] : block->Texture
+                    );
 
-                    if (extraOffset == 0) {
-                        extraOffset = static_cast<unsigned int>(VBOData.size() - 1);
+                    for (int const &corner : quad_corners[bit]) {
+                        Extend(data, vertices[bit][corner] * static_cast<float>(factor) + posOffset);
+                        Extend(data, tex_coords[bit][corner] * static_cast<float>(factor));
+                        data.push_back(texture);
+                        data.push_back(cellLight[cellIndex(cell)]);
+                        data.push_back(0);
                     }
                 }
-
-                ++extraSides;
             }
+        }
+    }
+
+    return data;
+}
+
+void Chunk::Mesh() {
+    // Sections marked dirty after this point are picked up by the next pass.
+    int sections = DirtySections.exchange(0);
+    int lod = LOD;
+
+    if (!Meshed) {
+        sections = ALL_SECTIONS;
+    }
+
+    MeshSnapshot snapshot;
+    Take_Snapshot(snapshot);
+
+    FaceConnections = Connect_Faces(snapshot);
 
-            if (extraSides != 0) {
-                ExtraOffsets[*block] = {extraOffset, extraSides};
+    Data lodData;
+
+    if (lod == 0) {
+        for (int section = 0; section < CHUNK_SECTIONS; ++section) {
+            if (sections & (1 << section)) {
+                Mesh_Section(snapshot, section);
             }
         }
-
-        ++block;
     }
+    else {
+        lodData = Mesh_LOD(snapshot, lod);
+    }
+
+    std::lock_guard<std::mutex> lock(MeshMutex);
+
+    VBOData.clear();
+    PendingLayout = MeshLayout();
+
+    if (lod == 0) {
+        for (int section = 0; section < CHUNK_SECTIONS; ++section) {
+            auto const &mesh = Sections[static_cast<unsigned long>(section)];
+
+            PendingLayout.SectionOffsets[static_cast<unsigned long>(section)] =
+                static_cast<int>(VBOData.size()) / CHUNK_VERTEX_SIZE;
+            VBOData.insert(VBOData.end(), mesh.Opaque.begin(), mesh.Opaque.end());
+        }
 
-    if (VBOData.size() > 0) {
-        Meshed = true;
+        PendingLayout.SectionRanges = true;
+        PendingLayout.SectionOffsets[CHUNK_SECTIONS] = static_cast<int>(VBOData.size()) / CHUNK_VERTEX_SIZE;
+
+        for (auto const &mesh : Sections) {
+            unsigned long base = PendingLayout.TransparentData.size();
+
+            for (auto const &range : mesh.TransparentRanges) {
+                PendingLayout.TransparentRanges.emplace_back(range.Position, base + range.Start, range.Length);
+            }
+
+            Data &transparent = PendingLayout.TransparentData;
+            transparent.insert(transparent.end(), mesh.Transparent.begin(), mesh.Transparent.end());
+        }
     }
+    else {
+        // Downsampled meshes are drawn entirely in the opaque pass.
+        VBOData.swap(lodData);
+    }
+
+    // The transparent range starts after the opaque one.
+    PendingLayout.OpaqueVertices = static_cast<int>(VBOData.size()) / CHUNK_VERTEX_SIZE;
+    VBOData.insert(VBOData.end(), PendingLayout.TransparentData.begin(), PendingLayout.TransparentData.end());
 
+    Meshed = true;
     DataUploaded = false;
+
+    // Sections dirtied while the chunk was meshed for the first time weren't scheduled.
+    if (DirtySections != 0) {
+        Chunks::Request_Remesh(this, 0);
+    }
 }
 
-void Chunk::Draw(bool transparentPass) {
-    if (!Meshed) {
+void Chunk::Mark_Dirty(glm::ivec3 tile) {
+    glm::ivec3 worldPos = Get_World_Pos(Position, tile);
+
+    // The faces and ambient occlusion of surrounding blocks, possibly in other chunks, change as well.
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            for (int z = -1; z <= 1; ++z) {
+                glm::vec3 chunk, neighborTile;
+                std::tie(chunk, neighborTile) = Get_Chunk_Pos(worldPos + glm::ivec3(x, y, z));
+
+                auto it = ChunkMap.find(chunk);
+
+                if (it != ChunkMap.end()) {
+                    Chunks::Request_Remesh(it->second, 1 << (static_cast<int>(neighborTile.y) / SECTION_HEIGHT));
+                }
+            }
+        }
+    }
+}
+
+void Chunk::Set_LOD(int lod) {
+    if (LOD == lod) {
         return;
     }
 
-    if (!DataUploaded) {
-        buffer.Upload(VBOData);
-        DataUploaded = true;
+    LOD = lod;
+    Chunks::Request_Remesh(this, ALL_SECTIONS);
+}
+
+void Chunk::Sort_Transparent(glm::vec3 viewPos) {
+    // Only the uploaded mesh is sorted, whose transparent range is known to fit inside the chunk's block.
+    const std::vector<TransparentRange> &ranges = Layout.TransparentRanges;
+
+    std::vector<std::pair<float, unsigned long>> order;
+    order.reserve(ranges.size());
+
+    for (unsigned long i = 0; i < ranges.size(); ++i) {
+        glm::vec3 center = Get_World_Pos(Position, ranges[i].Position) + glm::vec3(0.5f);
+        glm::vec3 diff = center - viewPos;
+        order.emplace_back(glm::dot(diff, diff), i);
+    }
+
+    // Farthest blocks first.
+    std::sort(order.begin(), order.end(), [](const std::pair<float, unsigned long> &a, const std::pair<float, unsigned long> &b) {
+        return a.first > b.first;
+    });
+
+    Data sortedData;
+    std::vector<TransparentRange> sortedRanges;
+
+    sortedData.reserve(Layout.TransparentData.size());
+    sortedRanges.reserve(ranges.size());
+
+    for (auto const &entry : order) {
+        const TransparentRange &range = ranges[entry.second];
+        auto rangeStart = Layout.TransparentData.begin() + static_cast<long>(range.Start);
+
+        sortedRanges.emplace_back(range.Position, sortedData.size(), range.Length);
+
+        sortedData.insert(sortedData.end(), rangeStart, rangeStart + static_cast<long>(range.Length));
     }
 
-    if (Visible) {
-        if (!transparentPass || ContainsTransparentBlocks) {
-            buffer.Draw();
+    Layout.TransparentData.swap(sortedData);
+    Layout.TransparentRanges.swap(sortedRanges);
+
+    Arena.Upload(ArenaStart, Layout.TransparentData, Layout.OpaqueVertices);
+}
+
+long Chunk::Upload() {
+    if (!Meshed || DataUploaded) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(MeshMutex);
+
+    if (DataUploaded) {
+        return 0;
+    }
+
+    int vertices = static_cast<int>(VBOData.size()) / CHUNK_VERTEX_SIZE;
+
+    // Move to a bigger block if the mesh has outgrown its current one.
+    if (vertices > ArenaSize) {
+        if (ArenaStart != -1) {
+            Arena.Free(ArenaStart);
         }
+
+        ArenaStart = Arena.Allocate(vertices);
+        ArenaSize = Arena.Get_Size(ArenaStart);
+    }
+
+    Arena.Upload(ArenaStart, VBOData);
+
+    // The new mesh is on the GPU, so draw it from now on.
+    Vertices = vertices;
+    Layout = std::move(PendingLayout);
+    PendingLayout = MeshLayout();
+
+    if (!Ready) {
+        ChunkCache::Record_Visible(this);
     }
+
+    DataUploaded = true;
+    Ready = true;
+    TransparentSorted = false;
+
+    long bytes = static_cast<long>(VBOData.size() * sizeof(float));
+
+    // The mesh lives on the GPU from now on, re-sorting only needs the transparent part.
+    Data().swap(VBOData);
+
+    return bytes;
 }
 
-void Chunk::Set_Extra_Texture(glm::ivec3 pos, int texture) {
-    if (!Blocks.count(pos)) {
+void Chunk::Draw(bool transparentPass) {
+    if (!Ready || !Visible) {
         return;
     }
 
-    int offset, sides;
-    std::tie(offset, sides) = ExtraOffsets[pos];
+    // Until a new mesh is uploaded, the previous one keeps being drawn.
+    std::lock_guard<std::mutex> lock(MeshMutex);
 
-    if (sides == 0) {
+    if (ArenaStart == -1) {
         return;
     }
 
-    int bufferSize = 54 * sides;
-    float* texPointer = buffer.Get_Pointer(offset, bufferSize);
+    if (!transparentPass) {
+        if (!Layout.SectionRanges) {
+            if (Layout.OpaqueVertices > 0) {
+                Arena.Queue(ArenaStart, 0, Layout.OpaqueVertices);
+            }
 
-    // TODO: Find some way to fix this, for now just ignore it.
-    // The error occurs when the memory mapping reaches 32 bytes too far.
-    // No consequences detected as of yet...
-	if (texPointer != nullptr) {
-        for (int o = 0; o < bufferSize; o += 9) {
-            *(texPointer + o) = static_cast<float>(texture);
+            return;
         }
-	}
 
-    buffer.Unbind_Pointer();
+        // Draw each run of neighbouring visible sections with one call.
+        int visible = VisibleSections;
+        int section = 0;
+
+        while (section < CHUNK_SECTIONS) {
+            if (!(visible & (1 << section))) {
+                ++section;
+                continue;
+            }
+
+            int first = section;
+
+            while (section < CHUNK_SECTIONS && (visible & (1 << section))) {
+                ++section;
+            }
+
+            int start = Layout.SectionOffsets[static_cast<unsigned long>(first)];
+            int end = Layout.SectionOffsets[static_cast<unsigned long>(section)];
+
+            if (end > start) {
+                Arena.Queue(ArenaStart, start, end - start);
+            }
+        }
+
+        return;
+    }
+
+    if (Vertices <= Layout.OpaqueVertices) {
+        return;
+    }
+
+    // Re-sort the translucent blocks whenever the camera enters a new block.
+    glm::ivec3 viewTile = glm::floor(Cam.Position);
+
+    if (!TransparentSorted || viewTile != SortedFrom) {
+        Sort_Transparent(Cam.Position);
+
+        SortedFrom = viewTile;
+        TransparentSorted = true;
+    }
+
+    Arena.Queue(ArenaStart, Layout.OpaqueVertices, Vertices - Layout.OpaqueVertices);
 }
 
 void Chunk::Remove_Multiblock(glm::ivec3 position, const Block* block) {
@@ -796,16 +1753,8 @@ void Chunk::Remove_Block(glm::ivec3 position, bool checkMulti) {
 
     Set_Type(position, 0);
     Set_Data(position, 0);
-    Blocks.erase(position);
 
-    if (TransparentBlocks.count(position)) {
-        TransparentBlocks.erase(position);
-
-        // Checks if chunk still contains transparent blocks
-        if (ContainsTransparentBlocks && TransparentBlocks.empty()) {
-            ContainsTransparentBlocks = false;
-        }
-    }
+    TransparentBlocks.erase(position);
 
     if (ChangedBlocks[Position].count(position)) {
         ChangedBlocks[Position].erase(position);
@@ -814,7 +1763,7 @@ void Chunk::Remove_Block(glm::ivec3 position, bool checkMulti) {
         ChangedBlocks[Position][position] = std::make_pair(0, 0);
     }
 
-    Worlds::Save_Chunk(WORLD_NAME, Position);
+    Worlds::Save_Block(WORLD_NAME, Position, position);
 
     bool lightBlocks = false;
 
@@ -823,7 +1772,7 @@ void Chunk::Remove_Block(glm::ivec3 position, bool checkMulti) {
         TopBlocks[Position.xz()][position.xz()]--;
     }
 
-    std::vector<Chunk*> meshingList;
+    std::vector<Chunk*> lightingList;
     std::vector<std::pair<glm::vec3, glm::vec3>> neighbors = Get_Neighbors(Position, position);
 
     for (unsigned long i = 0; i < 6; i++) {
@@ -833,7 +1782,6 @@ void Chunk::Remove_Block(glm::ivec3 position, bool checkMulti) {
         if (chunk != Position) {
             if (Exists(chunk)) {
                 if (ChunkMap[chunk]->Get_Type(tile)) {
-                    ChunkMap[chunk]->Blocks.insert(tile);
                     ChunkMap[chunk]->Get_Air_Ref(tile) |= 1 << i;
 
                     if (lightBlocks) {
@@ -841,12 +1789,11 @@ void Chunk::Remove_Block(glm::ivec3 position, bool checkMulti) {
                     }
 
                     ChunkMap[chunk]->LightQueue.emplace(chunk, position);
-                    meshingList.push_back(ChunkMap[chunk]);
+                    lightingList.push_back(ChunkMap[chunk]);
                 }
             }
         }
         else if (Get_Type(tile)) {
-            Blocks.insert(tile);
             Get_Air_Ref(tile) |= 1 << i;
 
             if (lightBlocks) {
@@ -857,13 +1804,13 @@ void Chunk::Remove_Block(glm::ivec3 position, bool checkMulti) {
         }
     }
 
-    Light(false);
-    Mesh();
+    Light();
 
-    for (auto const &chunk : meshingList) {
+    for (auto const &chunk : lightingList) {
         chunk->Light();
-        chunk->Mesh();
     }
+
+    Mark_Dirty(position);
 }
 
 void Chunk::Add_Block(glm::ivec3 position, int blockType, int blockData, bool checkMulti) {
@@ -876,7 +1823,6 @@ void Chunk::Add_Block(glm::ivec3 position, int blockType, int blockData, bool ch
 
     Set_Type(position, blockType);
     Set_Data(position, blockData);
-    Blocks.insert(position);
 
     if (ChangedBlocks[Position].count(position) && ChangedBlocks[Position][position] == std::pair<int, int>(0, 0)) {
         ChangedBlocks[Position].erase(position);
@@ -885,14 +1831,14 @@ void Chunk::Add_Block(glm::ivec3 position, int blockType, int blockData, bool ch
         ChangedBlocks[Position][position] = std::make_pair(blockType, blockData);
     }
 
-    Worlds::Save_Chunk(WORLD_NAME, Position);
+    Worlds::Save_Block(WORLD_NAME, Position, position);
 
     if (Position.y * CHUNK_SIZE + position.y > TopBlocks[Position.xz()][position.xz()]) {
         TopBlocks[Position.xz()][position.xz()] = static_cast<int>(Position.y * CHUNK_SIZE + position.y);
         Set_Light(position, SUN_LIGHT_LEVEL);
     }
 
-    std::vector<Chunk*> meshingList;
+    std::vector<Chunk*> lightingList;
 
     if (block->FullBlock && !block->Transparent) {
         std::vector<std::pair<glm::vec3, glm::vec3>> neighbors = Get_Neighbors(Position, position);
@@ -906,7 +1852,7 @@ void Chunk::Add_Block(glm::ivec3 position, int blockType, int blockData, bool ch
                     ChunkMap[chunk]->Get_Air_Ref(tile) &= ~(1 << i);
 
                     if (chunk != Position) {
-                        meshingList.push_back(ChunkMap[chunk]);
+                        lightingList.push_back(ChunkMap[chunk]);
                     }
                 }
                 else {
@@ -915,22 +1861,18 @@ void Chunk::Add_Block(glm::ivec3 position, int blockType, int blockData, bool ch
             }
         }
     }
-    else {
-        ContainsTransparentBlocks = true;
-
-        if (block->Transparent) {
-            TransparentBlocks.insert(position);
-            Update_Transparency(position);
-        }
+    else if (block->Transparent) {
+        TransparentBlocks.insert(position);
+        Update_Transparency(position);
     }
 
     Light();
-    Mesh();
 
-    for (auto const &chunk : meshingList) {
+    for (auto const &chunk : lightingList) {
         chunk->Light();
-        chunk->Mesh();
     }
+
+    Mark_Dirty(position);
 }
 
 std::vector<std::pair<glm::vec3, glm::vec3>> Get_Neighbors(glm::vec3 chunk, glm::vec3 tile) {
@@ -967,5 +1909,5 @@ bool Exists(glm::vec3 chunk) {
 		return false;
 	}
 
-	return ChunkMap[chunk]->DataUploaded;
+	return ChunkMap[chunk]->Ready;
 }
@@ -2,16 +2,36 @@
 
 #include <set>
 #include <array>
+#include <mutex>
 #include <queue>
+#include <tuple>
 #include <atomic>
 #include <thread>
-#include <unordered_set>
 
 #include "Buffer.h"
 #include "Comparators.h"
 
 const int CHUNK_SIZE = 16;
 
+// Number of floats per vertex in chunk meshes.
+// Position (3), texture coordinates (3), light level and ambient occlusion.
+const int CHUNK_VERTEX_SIZE = 8;
+
+// Chunk meshes are built from horizontal sections, which can be remeshed on their own.
+const int SECTION_HEIGHT = 4;
+const int CHUNK_SECTIONS = CHUNK_SIZE / SECTION_HEIGHT;
+const int ALL_SECTIONS = (1 << CHUNK_SECTIONS) - 1;
+
+// One bit for each of the 15 pairs of chunk faces.
+const int ALL_FACE_CONNECTIONS = (1 << 15) - 1;
+
+// Bump when terrain generation changes, so that cached chunk snapshots are regenerated.
+const int GENERATOR_VERSION = 1;
+
+// Chunks at least this far away (in chunks) are meshed from 2x, 4x and 8x downsampled blocks.
+const int LOD_LEVELS = 4;
+const float LOD_DISTANCES[LOD_LEVELS - 1] = {6.0f, 10.0f, 16.0f};
+
 template <class T, size_t... S>
 struct ArrayHelper;
 
@@ -31,14 +51,54 @@ using Array3D = typename ArrayHelper<T, A...>::type;
 extern std::map<glm::vec3, std::map<glm::vec3, std::pair<int, int>, VectorComparator>, ChunkPosComparator> ChangedBlocks;
 extern std::map<glm::vec2, std::map<glm::vec2, int, VectorComparator>, VectorComparator> TopBlocks;
 
+class Chunk;
+
 namespace Chunks {
     void Load_Structures();
 
     void Seed(int seed);
 	void Delete(glm::vec3 chunk);
+
+    // Creates the arena buffer that every chunk mesh is stored in.
+    void Init_Arena(Shader* chunkShader);
+
+    // Draws the visible chunks sorted by Cull, nearest first for the opaque pass
+    // and farthest first for the transparent pass, and the number of draw calls this frame.
+    void Draw(bool transparentPass = false);
+    int Get_Draw_Calls();
+    int Get_Drawn_Vertices();
+
+    // Wakes up the meshing thread, or waits for it to be woken up.
+    void Notify_Work();
+    void Wait_For_Work(int milliseconds);
+
+    // Remesh requests are collected during the frame, handed to the meshing thread once per frame,
+    // and processed there under a time budget.
+    void Request_Remesh(Chunk* chunk, int sections);
+    void Schedule_Remeshes();
+    void Process_Remeshes();
+
+    // Merges the saved changes read by the I/O threads into ChangedBlocks on the main thread,
+    // and marks those chunks as loaded so that the background thread generates them.
+    bool Receive_Changes(Chunk* chunk);
+    void Receive_Loads();
+
+    // Requested, coalesced and executed remeshes.
+    std::tuple<int, int, int> Get_Remesh_Stats();
+
+    int Get_LOD(float distance);
+
+    // Marks which chunks and sections are inside the view frustum,
+    // and hides chunks that can't be seen through the caves from the camera's chunk.
+    void Cull(glm::mat4 viewProjection, glm::vec3 cameraPos);
+
+    // Chunks inside the frustum, and the ones left after cave culling.
+    std::tuple<int, int> Get_Cull_Stats();
 };
 
 struct Block;
+struct MeshSnapshot;
+struct ChunkSnapshot;
 
 struct LightNode {
     glm::vec3 Chunk;
@@ -54,41 +114,111 @@ struct LightNode {
     }
 };
 
+// A block's vertices in the transparent part of a chunk mesh.
+struct TransparentRange {
+    glm::ivec3 Position;
+    unsigned long Start;
+    unsigned long Length;
+
+    TransparentRange(glm::ivec3 position, unsigned long start, unsigned long length) {
+        Position = position;
+        Start = start;
+        Length = length;
+    }
+};
+
+// The mesh of a single section, kept around so that unchanged sections don't need remeshing.
+struct SectionMesh {
+    Data Opaque;
+    Data Transparent;
+
+    std::vector<TransparentRange> TransparentRanges;
+};
+
+// Where the parts of an assembled mesh start, and its transparent blocks for re-sorting.
+struct MeshLayout {
+    int OpaqueVertices = 0;
+
+    // Where each section's opaque vertices start, if the mesh is split into sections.
+    bool SectionRanges = false;
+    std::array<int, CHUNK_SECTIONS + 1> SectionOffsets = {0};
+
+    Data TransparentData;
+    std::vector<TransparentRange> TransparentRanges;
+};
+
 class Chunk {
 public:
-    Buffer buffer;
     glm::vec3 Position;
 
     Data VBOData;
+
+    // The uploaded mesh holds the opaque vertices first, followed by the transparent ones.
+    int Vertices = 0;
     std::queue<LightNode> LightQueue;
     std::queue<LightNode> LightRemovalQueue;
 
-    std::map<glm::ivec3, std::pair<unsigned int, unsigned int>, VectorComparator> ExtraOffsets;
-
 	std::atomic_bool Meshed           = ATOMIC_VAR_INIT(false);
 	std::atomic_bool Visible          = ATOMIC_VAR_INIT(true);
 	std::atomic_bool Generated        = ATOMIC_VAR_INIT(false);
 	std::atomic_bool DataUploaded     = ATOMIC_VAR_INIT(false);
 
+    // Cleared while the chunk's saved changes are still being read from disk.
+	std::atomic_bool Loaded           = ATOMIC_VAR_INIT(true);
+
+    // Set once the first mesh has been uploaded, after which remeshing never hides the chunk.
+	std::atomic_bool Ready            = ATOMIC_VAR_INIT(false);
+
+    // One bit per section that needs to be remeshed.
+	std::atomic_int  DirtySections    = ATOMIC_VAR_INIT(0);
+
+    // Level of detail, where each level halves the resolution of the mesh.
+	std::atomic_int  LOD              = ATOMIC_VAR_INIT(0);
+
+    // One bit per section that's inside the view frustum.
+	std::atomic_int  VisibleSections  = ATOMIC_VAR_INIT(ALL_SECTIONS);
+
+    // Which pairs of faces are connected through air inside the chunk.
+	std::atomic_int  FaceConnections  = ATOMIC_VAR_INIT(ALL_FACE_CONNECTIONS);
+
+    // Set if the chunk was restored from the chunk cache instead of generated.
+	std::atomic_bool Restored         = ATOMIC_VAR_INIT(false);
+
+    // When the chunk was queued, for measuring how long it takes to become visible.
+    double QueuedTime = 0.0;
+
+    // Hash of the chunk's saved changes, taken on the main thread when they were merged into ChangedBlocks.
+    unsigned long long ChangesHash = 0;
+
     Chunk(glm::vec3 position) {
         Position = position;
     }
 
+    ~Chunk();
+
     inline int Get_Type(glm::uvec3 pos) { return BlockMap[pos.x][pos.y][pos.z]; }
     inline void Set_Type(glm::uvec3 pos, int value) { BlockMap[pos.x][pos.y][pos.z] = value; }
     inline unsigned char Get_Air(glm::uvec3 pos) { return SeesAir[pos.x][pos.y][pos.z]; }
     inline unsigned char& Get_Air_Ref(glm::uvec3 pos) { return SeesAir[pos.x][pos.y][pos.z]; }
 
-    inline int Get_Data(glm::vec3 pos) { return DataMap.count(pos) ? DataMap[pos] : 0; }
-    inline void Set_Data(glm::vec3 pos, int data) { DataMap[pos] = data; }
-
-    void Set_Extra_Texture(glm::ivec3 pos, int texture);
+    inline int Get_Data(glm::uvec3 pos) { return DataMap[pos.x][pos.y][pos.z]; }
+    inline void Set_Data(glm::uvec3 pos, int data) { DataMap[pos.x][pos.y][pos.z] = data; }
 
     void Generate();
-    void Light(bool flag = true);
+    void Light();
     void Mesh();
+
+    // Copies the generated and lit blocks into a snapshot, or takes them from one instead of generating them.
+    void Save_State(ChunkSnapshot &snapshot);
+    void Restore_State(const ChunkSnapshot &snapshot);
+
+    // Uploads a new mesh and returns its size in bytes, after which it replaces the one that's drawn.
+    long Upload();
     void Draw(bool transparentPass = false);
 
+    void Mark_Dirty(glm::ivec3 tile);
+    void Set_LOD(int lod);
+
     void Remove_Multiblock(glm::ivec3 position, const Block* block);
     void Add_Multiblock(glm::ivec3 position, const Block* block);
 
@@ -99,7 +229,12 @@ public:
         return LightMap[pos.x][pos.y][pos.z];
     }
     inline void Set_Light(glm::uvec3 pos, int value) {
-        LightMap[pos.x][pos.y][pos.z] = static_cast<unsigned char>(value);
+        unsigned char &light = LightMap[pos.x][pos.y][pos.z];
+
+        if (light != value) {
+            light = static_cast<unsigned char>(value);
+            Chunks::Request_Remesh(this, 1 << (pos.y / SECTION_HEIGHT));
+        }
     }
 
     inline bool Top_Exists(glm::ivec3 tile) {
@@ -112,8 +247,23 @@ public:
         TopBlocks[Position.xz()][tile.xz()] = value;
     }
 private:
-    bool ContainsChangedBlocks     = false;
-    bool ContainsTransparentBlocks = false;
+    bool ContainsChangedBlocks = false;
+    bool TransparentSorted     = false;
+
+    // The chunk's block in the arena buffer.
+    int ArenaStart = -1;
+    int ArenaSize = 0;
+
+    // The camera tile the transparent blocks were last sorted from.
+    glm::ivec3 SortedFrom;
+
+    // The layout of the mesh waiting in VBOData, and of the uploaded one that's drawn.
+    MeshLayout PendingLayout;
+    MeshLayout Layout;
+
+    // Guards the assembled mesh, which the meshing thread replaces while the chunk is drawn.
+    std::mutex MeshMutex;
+    std::array<SectionMesh, CHUNK_SECTIONS> Sections;
 
     void Update_Air(glm::ivec3 pos, glm::bvec3 inChunk);
     void Update_Transparency(glm::ivec3 pos);
@@ -122,14 +272,17 @@ private:
     void Generate_Tree(glm::vec3 tile);
     void Check_Ore(glm::ivec3 pos, glm::dvec3 noisePos);
 
-    float GetAO(glm::vec3 block, int face, int offset);
+    void Take_Snapshot(MeshSnapshot &snapshot);
+    float GetAO(const MeshSnapshot &snapshot, glm::ivec3 block, int face, int offset);
+    void Mesh_Section(const MeshSnapshot &snapshot, int section);
+    Data Mesh_LOD(const MeshSnapshot &snapshot, int lod);
+    void Sort_Transparent(glm::vec3 viewPos);
 
     Array3D<int, CHUNK_SIZE>           BlockMap = {0};
     Array3D<unsigned char, CHUNK_SIZE> LightMap = {0};
     Array3D<unsigned char, CHUNK_SIZE> SeesAir  = {0};
+    Array3D<int, CHUNK_SIZE>           DataMap  = {0};
 
-    std::unordered_set<glm::vec3, VectorHasher> Blocks;
-    std::map<glm::vec3, int, VectorComparator> DataMap;
     std::set<glm::vec3, VectorComparator> TransparentBlocks;
 };
 
@@ -0,0 +1,390 @@
+#include "ChunkCache.h"
+
+#include <map>
+#include <list>
+#include <mutex>
+#include <string>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+#include <GLFW/glfw3.h>
+#include <boost/filesystem.hpp>
+
+#include "main.h"
+#include "Chunk.h"
+#include "Worlds.h"
+
+// Snapshot files on disk start with this header, followed by the palette, blocks, light, air and column tops.
+struct SnapshotHeader {
+    char Magic[4];
+    int Version;
+    int GeneratorVersion;
+    int Seed;
+    unsigned long long ChangesHash;
+    int PaletteSize;
+};
+
+static const int SNAPSHOT_VERSION = 1;
+
+static const int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+static const int CHUNK_AREA = CHUNK_SIZE * CHUNK_SIZE;
+
+// A snapshot kept in memory, with the palette indices, light levels and air flags run-length encoded.
+// Light levels fit in 4 bits, so two of them are packed into each byte before encoding.
+struct CompressedSnapshot {
+    unsigned long long ChangesHash;
+    std::vector<std::pair<int, int>> Palette;
+    std::vector<int> Tops;
+
+    std::string Blocks;
+    std::string Light;
+    std::string Air;
+
+    std::list<glm::vec3>::iterator Recent;
+
+    unsigned long Size() const {
+        return sizeof(*this) + Palette.size() * sizeof(Palette[0]) + Tops.size() * sizeof(int) +
+               Blocks.size() + Light.size() + Air.size();
+    }
+};
+
+// The world and seed of the snapshots in memory, and the most recently stored snapshots first.
+static std::string CacheWorld;
+static int CacheSeed = 0;
+static std::list<glm::vec3> RecentChunks;
+static std::map<glm::vec3, CompressedSnapshot, VectorComparator> Snapshots;
+static unsigned long CacheSize = 0;
+static std::mutex CacheMutex;
+
+static int RestoredChunks = 0;
+static int GeneratedChunks = 0;
+static double RestoredTime = 0.0;
+static double GeneratedTime = 0.0;
+
+static int CacheHits = 0;
+static int CacheMisses = 0;
+
+static std::string Get_Snapshot_Path(std::string world, glm::vec3 chunkPos) {
+    glm::ivec3 pos = static_cast<glm::ivec3>(chunkPos);
+
+    return "Worlds/" + world + "/Cache/" +
+           std::to_string(pos.x) + "," + std::to_string(pos.y) + "," + std::to_string(pos.z) + ".snapshot";
+}
+
+template <typename T>
+static void Append(std::string &out, const std::vector<T> &values) {
+    out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+template <typename T>
+static bool Read(std::ifstream &file, std::vector<T> &values, unsigned long count) {
+    values.resize(count);
+    file.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+    return file.good();
+}
+
+static void Write_Snapshot(std::string path, const ChunkSnapshot &snapshot, int seed) {
+    SnapshotHeader header = {
+        {'C', 'M', 'C', 'S'}, SNAPSHOT_VERSION, GENERATOR_VERSION, seed,
+        snapshot.ChangesHash, static_cast<int>(snapshot.Palette.size())
+    };
+
+    std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    Append(contents, snapshot.Palette);
+    Append(contents, snapshot.Blocks);
+    Append(contents, snapshot.Light);
+    Append(contents, snapshot.Air);
+    Append(contents, snapshot.Tops);
+
+    boost::system::error_code error;
+    boost::filesystem::create_directories(boost::filesystem::path(path).parent_path(), error);
+
+    // Write to a temporary file first, so that a partial snapshot is never loaded.
+    std::ofstream file(path + ".tmp", std::ios::binary | std::ios::trunc);
+    file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    file.close();
+
+    if (file.good()) {
+        boost::filesystem::rename(path + ".tmp", path, error);
+    }
+}
+
+static bool Read_Snapshot(std::string path, ChunkSnapshot &snapshot) {
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file.good()) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!file.good() || std::string(header.Magic, 4) != "CMCS" || header.Version != SNAPSHOT_VERSION ||
+        header.GeneratorVersion != GENERATOR_VERSION || header.Seed != WORLD_SEED ||
+        header.PaletteSize <= 0 || header.PaletteSize > CHUNK_VOLUME) {
+        return false;
+    }
+
+    snapshot.ChangesHash = header.ChangesHash;
+
+    return Read(file, snapshot.Palette, static_cast<unsigned long>(header.PaletteSize)) &&
+           Read(file, snapshot.Blocks, CHUNK_VOLUME) && Read(file, snapshot.Light, CHUNK_VOLUME) &&
+           Read(file, snapshot.Air, CHUNK_VOLUME) && Read(file, snapshot.Tops, CHUNK_AREA);
+}
+
+// Forgets the snapshots in memory if another world has been loaded since they were stored.
+// Requires CacheMutex.
+static void Check_World() {
+    if (CacheWorld != WORLD_NAME || CacheSeed != WORLD_SEED) {
+        CacheWorld = WORLD_NAME;
+        CacheSeed = WORLD_SEED;
+
+        Snapshots.clear();
+        RecentChunks.clear();
+        CacheSize = 0;
+    }
+}
+
+// Encodes values as runs of a 16-bit length followed by the value.
+template <typename T>
+static std::string Encode_Runs(const std::vector<T> &values) {
+    std::string runs;
+
+    for (unsigned long start = 0; start < values.size();) {
+        unsigned short length = 1;
+
+        while (start + length < values.size() && length < 65535 && values[start + length] == values[start]) {
+            ++length;
+        }
+
+        runs.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        runs.append(reinterpret_cast<const char*>(&values[start]), sizeof(T));
+        start += length;
+    }
+
+    return runs;
+}
+
+template <typename T>
+static bool Decode_Runs(const std::string &runs, std::vector<T> &values, unsigned long count) {
+    values.clear();
+    values.reserve(count);
+
+    for (unsigned long offset = 0; offset + sizeof(unsigned short) + sizeof(T) <= runs.size();) {
+        unsigned short length;
+        T value;
+
+        std::memcpy(&length, runs.data() + offset, sizeof(length));
+        std::memcpy(&value, runs.data() + offset + sizeof(length), sizeof(T));
+        offset += sizeof(length) + sizeof(T);
+
+        if (values.size() + length > count) {
+            return false;
+        }
+
+        values.insert(values.end(), length, value);
+    }
+
+    return values.size() == count;
+}
+
+static void Compress(const ChunkSnapshot &snapshot, CompressedSnapshot &compressed) {
+    std::vector<unsigned char> light(snapshot.Light.size() / 2);
+
+    for (unsigned long i = 0; i < light.size(); ++i) {
+        light[i] = static_cast<unsigned char>((snapshot.Light[i * 2] & 15) | (snapshot.Light[i * 2 + 1] << 4));
+    }
+
+    compressed.ChangesHash = snapshot.ChangesHash;
+    compressed.Palette = snapshot.Palette;
+    compressed.Tops = snapshot.Tops;
+
+    compressed.Blocks = Encode_Runs(snapshot.Blocks);
+    compressed.Light = Encode_Runs(light);
+    compressed.Air = Encode_Runs(snapshot.Air);
+}
+
+static bool Decompress(const CompressedSnapshot &compressed, ChunkSnapshot &snapshot) {
+    std::vector<unsigned char> light;
+
+    if (!Decode_Runs(compressed.Blocks, snapshot.Blocks, CHUNK_VOLUME) ||
+        !Decode_Runs(compressed.Light, light, CHUNK_VOLUME / 2) ||
+        !Decode_Runs(compressed.Air, snapshot.Air, CHUNK_VOLUME)) {
+        return false;
+    }
+
+    snapshot.Light.resize(CHUNK_VOLUME);
+
+    for (unsigned long i = 0; i < light.size(); ++i) {
+        snapshot.Light[i * 2] = light[i] & 15;
+        snapshot.Light[i * 2 + 1] = light[i] >> 4;
+    }
+
+    snapshot.ChangesHash = compressed.ChangesHash;
+    snapshot.Palette = compressed.Palette;
+    snapshot.Tops = compressed.Tops;
+
+    return true;
+}
+
+// Requires CacheMutex.
+static void Remove_Snapshot(std::map<glm::vec3, CompressedSnapshot, VectorComparator>::iterator cached) {
+    CacheSize -= cached->second.Size();
+    RecentChunks.erase(cached->second.Recent);
+    Snapshots.erase(cached);
+}
+
+static bool Valid(const ChunkSnapshot &snapshot) {
+    for (unsigned short const &index : snapshot.Blocks) {
+        if (index >= snapshot.Palette.size()) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+unsigned long long ChunkCache::Hash_Changes(glm::vec3 chunkPos) {
+    // 64-bit FNV-1a over the positions and types of the changed blocks.
+    unsigned long long hash = 14695981039346656037ULL;
+    auto changedBlocks = ChangedBlocks.find(chunkPos);
+
+    if (changedBlocks == ChangedBlocks.end()) {
+        return hash;
+    }
+
+    for (auto const &block : changedBlocks->second) {
+        int values[5] = {
+            static_cast<int>(block.first.x), static_cast<int>(block.first.y), static_cast<int>(block.first.z),
+            block.second.first, block.second.second
+        };
+
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+
+        for (unsigned long i = 0; i < sizeof(values); ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    return hash;
+}
+
+void ChunkCache::Store(Chunk* chunk) {
+    if (!chunk->Generated || !chunk->Meshed || !chunk->LightQueue.empty() || !chunk->LightRemovalQueue.empty()) {
+        return;
+    }
+
+    ChunkSnapshot snapshot;
+    chunk->Save_State(snapshot);
+    snapshot.ChangesHash = Hash_Changes(chunk->Position);
+
+    if (CHUNK_CACHE && !Multiplayer) {
+        std::string path = Get_Snapshot_Path(WORLD_NAME, chunk->Position);
+        int seed = WORLD_SEED;
+
+        Worlds::Queue_IO([path, snapshot, seed] { Write_Snapshot(path, snapshot, seed); });
+    }
+
+    unsigned long budget = static_cast<unsigned long>(std::max(CHUNK_CACHE_MEMORY, 0)) * 1024 * 1024;
+
+    CompressedSnapshot compressed;
+    Compress(snapshot, compressed);
+
+    std::lock_guard<std::mutex> lock(CacheMutex);
+    Check_World();
+
+    auto cached = Snapshots.find(chunk->Position);
+
+    if (cached != Snapshots.end()) {
+        Remove_Snapshot(cached);
+    }
+
+    if (compressed.Size() > budget) {
+        return;
+    }
+
+    RecentChunks.push_front(chunk->Position);
+    compressed.Recent = RecentChunks.begin();
+
+    CacheSize += compressed.Size();
+    Snapshots.emplace(chunk->Position, std::move(compressed));
+
+    // Evict the least recently stored snapshots until the cache fits in its budget.
+    while (CacheSize > budget) {
+        Remove_Snapshot(Snapshots.find(RecentChunks.back()));
+    }
+}
+
+bool ChunkCache::Restore(Chunk* chunk) {
+    ChunkSnapshot snapshot;
+    bool found = false;
+
+    {
+        std::lock_guard<std::mutex> lock(CacheMutex);
+        Check_World();
+
+        auto cached = Snapshots.find(chunk->Position);
+
+        if (cached != Snapshots.end()) {
+            found = Decompress(cached->second, snapshot);
+            Remove_Snapshot(cached);
+        }
+
+        if (found) {
+            ++CacheHits;
+        }
+        else {
+            ++CacheMisses;
+        }
+    }
+
+    if (!found && CHUNK_CACHE && !Multiplayer) {
+        found = Read_Snapshot(Get_Snapshot_Path(WORLD_NAME, chunk->Position), snapshot);
+    }
+
+    // Blocks may have been changed while the chunk was unloaded, for example by other players.
+    // This runs on the background thread, so the hash taken when the changes were merged is compared.
+    if (found && (snapshot.ChangesHash != chunk->ChangesHash || !Valid(snapshot))) {
+        found = false;
+    }
+
+    if (found) {
+        chunk->Restore_State(snapshot);
+    }
+
+    chunk->Restored = found;
+    return found;
+}
+
+void ChunkCache::Record_Visible(const Chunk* chunk) {
+    double time = glfwGetTime() - chunk->QueuedTime;
+
+    std::lock_guard<std::mutex> lock(CacheMutex);
+
+    if (chunk->Restored) {
+        ++RestoredChunks;
+        RestoredTime += time;
+    }
+    else {
+        ++GeneratedChunks;
+        GeneratedTime += time;
+    }
+}
+
+std::tuple<int, int, double, double> ChunkCache::Get_Stats() {
+    std::lock_guard<std::mutex> lock(CacheMutex);
+
+    return std::make_tuple(
+        RestoredChunks, GeneratedChunks,
+        RestoredChunks > 0 ? RestoredTime / RestoredChunks * 1000 : 0.0,
+        GeneratedChunks > 0 ? GeneratedTime / GeneratedChunks * 1000 : 0.0
+    );
+}
+
+std::tuple<int, int, int, long> ChunkCache::Get_Memory_Stats() {
+    std::lock_guard<std::mutex> lock(CacheMutex);
+    return std::make_tuple(CacheHits, CacheMisses, static_cast<int>(Snapshots.size()), static_cast<long>(CacheSize));
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <tuple>
+#include <vector>
+#include <utility>
+
+#define GLM_SWIZZLE
+#include <glm/glm.hpp>
+
+class Chunk;
+
+// Marks a column whose highest block isn't inside the chunk.
+const int NO_TOP = -2147483647 - 1;
+
+// The generated and lit state of a chunk, with blocks stored as indices into a palette of (type, data) pairs.
+struct ChunkSnapshot {
+    // Hash of the chunk's entry in ChangedBlocks when the snapshot was taken.
+    unsigned long long ChangesHash = 0;
+
+    std::vector<std::pair<int, int>> Palette;
+
+    std::vector<unsigned short> Blocks;
+    std::vector<unsigned char> Light;
+    std::vector<unsigned char> Air;
+
+    // The height of each column's highest block, if it's inside the chunk.
+    std::vector<int> Tops;
+};
+
+namespace ChunkCache {
+    // Keeps the state of a generated and lit chunk that's being unloaded, compressed in memory within
+    // the ChunkCacheMemory budget, and on disk if the ChunkCache setting is on.
+    void Store(Chunk* chunk);
+
+    // Restores a chunk from the cache instead of generating and lighting it, and returns whether it was cached.
+    // Snapshots made with another seed, generator version or set of changed blocks are ignored.
+    bool Restore(Chunk* chunk);
+
+    // Hashes the chunk's entry in ChangedBlocks. Only called from the main thread, which owns ChangedBlocks.
+    unsigned long long Hash_Changes(glm::vec3 chunkPos);
+
+    // Records how long it took from queueing a chunk until it was first uploaded.
+    void Record_Visible(const Chunk* chunk);
+
+    // Restored chunks, generated chunks, and their average time until visible in milliseconds.
+    std::tuple<int, int, double, double> Get_Stats();
+
+    // Chunks found and not found in memory, and the number and size in bytes of the compressed snapshots there.
+    std::tuple<int, int, int, long> Get_Memory_Stats();
+}
@@ -1,28 +1,27 @@
 #include "Entity.h"
 
+#include <map>
 #include <random>
-#include <glm/gtc/matrix_transform.hpp>
 
 #include "main.h"
 #include "Chunk.h"
 #include "Blocks.h"
 #include "Shader.h"
 #include "Interface.h"
+#include "RenderQueue.h"
 
 std::vector<EntityInstance*> Entities;
 
+// One mesh per kind of item, and the instances of each kind that are drawn this frame.
+static std::map<std::pair<int, int>, Buffer> ItemMeshes;
+static std::map<std::pair<int, int>, Data> ItemInstances;
+
 EntityInstance::EntityInstance(glm::vec3 pos, int type, int typeData, int size, glm::vec3 velocity) {
     Position = pos + glm::vec3(0.5f);
     Type = type;
     Size = size;
     BlockData = typeData;
 
-    Data data;
-    Blocks::Mesh(data, Blocks::Get_Block(type, typeData), glm::vec3(-0.5f), ENTITY_SCALE);
-
-    EntityBuffer.Init(modelShader);
-    EntityBuffer.Create(3, 3, data);
-
     if (velocity == glm::vec3(-100)) {
         Velocity.y += 0.05f;
 
@@ -133,15 +132,11 @@ void EntityInstance::Draw() {
         }
     }
 
-    glm::mat4 model;
-    model = glm::translate(model, Position);
-    model = glm::rotate(model, glm::radians(Rotation), glm::vec3(0, 1, 0));
-
-    modelShader->Upload("lightLevel", lightLevel);
-    modelShader->Upload("model", model);
-    modelShader->Upload("tex", 0);
+    Data &instances = ItemInstances[std::make_pair(Type, BlockData)];
 
-    EntityBuffer.Draw();
+    Extend(instances, Position);
+    instances.push_back(glm::radians(Rotation));
+    instances.push_back(static_cast<float>(lightLevel));
 }
 
 
@@ -167,7 +162,33 @@ void Entity::Update() {
 }
 
 void Entity::Draw() {
+    for (auto &instances : ItemInstances) {
+        instances.second.clear();
+    }
+
     for (auto const &entity: Entities) {
         entity->Draw();
     }
+
+    // Draw all items of a kind with one call.
+    for (auto const &instances : ItemInstances) {
+        if (instances.second.empty()) {
+            continue;
+        }
+
+        auto mesh = ItemMeshes.find(instances.first);
+
+        if (mesh == ItemMeshes.end()) {
+            Data data;
+            Blocks::Mesh(data, Blocks::Get_Block(instances.first.first, instances.first.second), glm::vec3(-0.5f), ENTITY_SCALE);
+
+            mesh = ItemMeshes.emplace(instances.first, Buffer()).first;
+            mesh->second.Init(itemShader);
+            mesh->second.Create(3, 3, data);
+            mesh->second.Create_Instances({3, 1, 1});
+        }
+
+        mesh->second.Upload_Instances(instances.second);
+        RenderQueue::Add(&mesh->second);
+    }
 }
@@ -34,8 +34,6 @@ private:
     float Rotation = 0.0f;
     bool OnGround = false;
 
-    Buffer EntityBuffer;
-
     void Col_Check();
 };
 
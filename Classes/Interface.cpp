@@ -1,7 +1,18 @@
 #include "Interface.h"
 
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <algorithm>
 
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+#include <boost/filesystem.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <freetype2/ft2build.h>
@@ -156,17 +167,15 @@ Data Get_3D_Mesh(const Block* block, float x, float y, bool offsets) {
     }
 
     else if (block->HasCustomData) {
-        for (auto const &element : block->CustomData) {
-            for (unsigned long i = 0; i < 6; i++) {
-                for (unsigned long j = 0; j < 6; j++) {
-                    Extend(data, element[i][j].first);
-                    Extend(data, element[i][j].second);
-
-                    if (offsets) {
-                        Extend(data, x, y);
-                    }
-                }
-            }
+        auto const &model = block->ModelTriangles;
+
+        if (!offsets) {
+            return model;
+        }
+
+        for (unsigned long i = 0; i < model.size(); i += 6) {
+            data.insert(data.end(), model.begin() + static_cast<long>(i), model.begin() + static_cast<long>(i) + 6);
+            Extend(data, x, y);
         }
     }
 
@@ -218,22 +227,187 @@ std::tuple<unsigned int, int, int> Load_Texture(std::string file, bool mipmap, f
     return std::make_tuple(texture, width, height);
 }
 
-unsigned int Load_Array_Texture(std::string file, glm::ivec2 subCount, int mipmap, float afLevel) {
-    std::string path = "Images/" + file;
+// Cached texture arrays start with this header, followed by every mipmap level, largest first.
+struct TextureCacheHeader {
+    char Magic[4];
+    int Version;
 
-    unsigned int texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    // The source image the cache was made from.
+    long long SourceSize;
+    long long SourceTime;
 
-    FREE_IMAGE_FORMAT format = FreeImage_GetFileType(path.c_str(), 0);
-    FIBITMAP* image = FreeImage_Load(format, path.c_str());
+    int Width;
+    int Height;
+    int Layers;
+    int Levels;
+};
+
+static const int TEXTURE_CACHE_VERSION = 1;
+
+static long Get_Level_Size(glm::ivec3 size, int level) {
+    return static_cast<long>(std::max(size.x >> level, 1)) * std::max(size.y >> level, 1) * size.z * 4;
+}
 
-    FreeImage_FlipVertical(image);
+static void Upload_Levels(const unsigned char* pixels, glm::ivec3 size, int levels) {
+    for (int level = 0; level < levels; ++level) {
+        glTexSubImage3D(
+            GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+            std::max(size.x >> level, 1), std::max(size.y >> level, 1), size.z,
+            GL_BGRA, GL_UNSIGNED_BYTE, pixels
+        );
+
+        pixels += Get_Level_Size(size, level);
+    }
+}
+
+// Splits an image into layers of the given size and builds their mipmaps, as BGRA pixels.
+static std::vector<unsigned char> Decode_Array_Texture(std::string path, glm::ivec2 subCount, int levels, glm::ivec3 &size) {
+    FREE_IMAGE_FORMAT format = FreeImage_GetFileType(path.c_str(), 0);
+    FIBITMAP* source = FreeImage_Load(format, path.c_str());
+    FIBITMAP* image = FreeImage_ConvertTo32Bits(source);
+    FreeImage_Unload(source);
 
     int width  = static_cast<int>(FreeImage_GetWidth(image));
     int height = static_cast<int>(FreeImage_GetHeight(image));
 
-    glm::ivec2 subSize(width / subCount.x, height / subCount.y);
+    size = glm::ivec3(width / subCount.x, height / subCount.y, subCount.x * subCount.y);
+
+    long total = 0;
+
+    for (int level = 0; level < levels; ++level) {
+        total += Get_Level_Size(size, level);
+    }
+
+    std::vector<unsigned char> pixels(static_cast<unsigned long>(total));
+    unsigned long rowSize = static_cast<unsigned long>(size.x) * 4;
+    unsigned char* layer = pixels.data();
+
+    // Layers go from the top left of the image, and FreeImage stores its rows bottom up.
+    for (int y = 0; y < subCount.y; ++y) {
+        for (int x = 0; x < subCount.x; ++x) {
+            for (int row = 0; row < size.y; ++row) {
+                const unsigned char* line = FreeImage_GetScanLine(image, height - 1 - (y * size.y + row));
+                std::memcpy(layer + row * rowSize, line + x * rowSize, rowSize);
+            }
+
+            layer += rowSize * static_cast<unsigned long>(size.y);
+        }
+    }
+
+    FreeImage_Unload(image);
+
+    // Each mipmap level averages 2x2 texels of the one above it.
+    const unsigned char* previous = pixels.data();
+    unsigned char* current = pixels.data() + Get_Level_Size(size, 0);
+
+    for (int level = 1; level < levels; ++level) {
+        int prevWidth  = std::max(size.x >> (level - 1), 1);
+        int prevHeight = std::max(size.y >> (level - 1), 1);
+        int levelWidth  = std::max(size.x >> level, 1);
+        int levelHeight = std::max(size.y >> level, 1);
+
+        for (int z = 0; z < size.z; ++z) {
+            const unsigned char* src = previous + static_cast<long>(z) * prevWidth * prevHeight * 4;
+            unsigned char* dst = current + static_cast<long>(z) * levelWidth * levelHeight * 4;
+
+            for (int y = 0; y < levelHeight; ++y) {
+                for (int x = 0; x < levelWidth; ++x) {
+                    int x0 = std::min(x * 2, prevWidth - 1), x1 = std::min(x * 2 + 1, prevWidth - 1);
+                    int y0 = std::min(y * 2, prevHeight - 1), y1 = std::min(y * 2 + 1, prevHeight - 1);
+
+                    for (int c = 0; c < 4; ++c) {
+                        int sum = src[(y0 * prevWidth + x0) * 4 + c] + src[(y0 * prevWidth + x1) * 4 + c]
+                                + src[(y1 * prevWidth + x0) * 4 + c] + src[(y1 * prevWidth + x1) * 4 + c];
+
+                        dst[(y * levelWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                    }
+                }
+            }
+        }
+
+        previous = current;
+        current += Get_Level_Size(size, level);
+    }
+
+    return pixels;
+}
+
+// Uploads a texture array from its cache file, if the file matches the header.
+static bool Load_Cached_Texture(std::string path, TextureCacheHeader expected) {
+#ifdef _WIN32
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file.good()) {
+        return false;
+    }
+
+    std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    const char* data = contents.data();
+    long fileSize = static_cast<long>(contents.size());
+#else
+    int descriptor = open(path.c_str(), O_RDONLY);
+
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat info;
+    fstat(descriptor, &info);
+
+    long fileSize = static_cast<long>(info.st_size);
+    void* mapping = mmap(nullptr, static_cast<unsigned long>(fileSize), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    const char* data = static_cast<const char*>(mapping);
+#endif
+
+    long pixelSize = 0;
+
+    for (int level = 0; level < expected.Levels; ++level) {
+        pixelSize += Get_Level_Size(glm::ivec3(expected.Width, expected.Height, expected.Layers), level);
+    }
+
+    TextureCacheHeader header;
+    bool valid = fileSize == static_cast<long>(sizeof(header)) + pixelSize;
+
+    if (valid) {
+        std::memcpy(&header, data, sizeof(header));
+
+        valid = std::memcmp(header.Magic, expected.Magic, 4) == 0 && header.Version == expected.Version &&
+                header.SourceSize == expected.SourceSize && header.SourceTime == expected.SourceTime &&
+                header.Width == expected.Width && header.Height == expected.Height &&
+                header.Layers == expected.Layers && header.Levels == expected.Levels;
+    }
+
+    if (valid) {
+        Upload_Levels(
+            reinterpret_cast<const unsigned char*>(data + sizeof(header)),
+            glm::ivec3(header.Width, header.Height, header.Layers), header.Levels
+        );
+    }
+
+#ifndef _WIN32
+    munmap(mapping, static_cast<unsigned long>(fileSize));
+#endif
+
+    return valid;
+}
+
+unsigned int Load_Array_Texture(std::string file, glm::ivec2 subCount, int mipmap, float afLevel) {
+    std::string path = "Images/" + file;
+    std::string cachePath = "Cache/" + file + "." + std::to_string(subCount.x) + "x" + std::to_string(subCount.y) +
+                            "." + std::to_string(mipmap) + ".bin";
+
+    int levels = mipmap + 1;
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
 
     glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY_EXT, afLevel);
 
@@ -248,31 +422,47 @@ unsigned int Load_Array_Texture(std::string file, glm::ivec2 subCount, int mipma
         glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     }
 
-    glTexStorage3D(
-        GL_TEXTURE_2D_ARRAY, mipmap + 1, GL_RGBA8,
-        subSize.x, subSize.y, (width * height) / (subSize.x * subSize.y)
+    // The layer size is needed before the cache can be checked, so read it without decoding the image.
+    FREE_IMAGE_FORMAT format = FreeImage_GetFileType(path.c_str(), 0);
+    FIBITMAP* info = FreeImage_Load(format, path.c_str(), FIF_LOAD_NOPIXELS);
+
+    glm::ivec3 size(
+        static_cast<int>(FreeImage_GetWidth(info)) / subCount.x,
+        static_cast<int>(FreeImage_GetHeight(info)) / subCount.y,
+        subCount.x * subCount.y
     );
 
-    int layer = 0;
+    FreeImage_Unload(info);
 
-    for (int h = 0; h < height; h += subSize.y) {
-        for (int w = 0; w < width; w += subSize.x) {
-            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0,
-                layer++, subSize.x, subSize.y, 1, GL_BGRA, GL_UNSIGNED_BYTE,
-                reinterpret_cast<void*>(FreeImage_GetBits(
-                    FreeImage_Copy(image, w, height - h, w + subSize.x, height - h - subSize.y)
-                ))
-            );
-        }
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, size.x, size.y, size.z);
+
+    TextureCacheHeader header = {{'C', 'M', 'T', 'X'}, TEXTURE_CACHE_VERSION, 0, 0, size.x, size.y, size.z, levels};
+
+    header.SourceSize = static_cast<long long>(boost::filesystem::file_size(path));
+    header.SourceTime = static_cast<long long>(boost::filesystem::last_write_time(path));
+
+    if (Load_Cached_Texture(cachePath, header)) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return texture;
     }
 
-    if (mipmap > 0) {
-        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    std::vector<unsigned char> pixels = Decode_Array_Texture(path, subCount, levels, size);
+    Upload_Levels(pixels.data(), size, levels);
+
+    // Write the cache to a temporary file first, so that a partial file is never loaded.
+    boost::filesystem::create_directories("Cache");
+
+    std::ofstream cache(cachePath + ".tmp", std::ios::binary | std::ios::trunc);
+    cache.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    cache.write(reinterpret_cast<const char*>(pixels.data()), static_cast<long>(pixels.size()));
+    cache.close();
+
+    if (cache.good()) {
+        boost::system::error_code error;
+        boost::filesystem::rename(cachePath + ".tmp", cachePath, error);
     }
 
-    FreeImage_Unload(image);
     glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
-
     return texture;
 }
 
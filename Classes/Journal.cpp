@@ -0,0 +1,119 @@
+#include "Journal.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include <boost/filesystem.hpp>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+// Flushes the file's contents from the OS cache to the disk.
+static bool Sync_File(const std::string &path) {
+#ifdef _WIN32
+    int file = _open(path.c_str(), _O_RDWR | _O_BINARY);
+
+    if (file < 0) {
+        return false;
+    }
+
+    bool synced = _commit(file) == 0;
+    _close(file);
+#else
+    int file = open(path.c_str(), O_RDONLY);
+
+    if (file < 0) {
+        return false;
+    }
+
+    bool synced = fsync(file) == 0;
+    close(file);
+#endif
+
+    return synced;
+}
+
+bool Journal::Append(const std::string &path, const std::vector<JournalRecord> &records) {
+    std::ofstream file(path, std::ofstream::binary | std::ofstream::app);
+    file.write(
+        reinterpret_cast<const char*>(records.data()),
+        static_cast<std::streamsize>(records.size() * sizeof(JournalRecord))
+    );
+    file.close();
+
+    return file.good();
+}
+
+std::vector<JournalRecord> Journal::Read(const std::string &path) {
+    std::vector<JournalRecord> records;
+
+    boost::system::error_code error;
+    unsigned long size = static_cast<unsigned long>(boost::filesystem::file_size(path, error));
+
+    if (error) {
+        return records;
+    }
+
+    records.resize(size / sizeof(JournalRecord));
+
+    {
+        std::ifstream file(path, std::ifstream::binary);
+        file.read(
+            reinterpret_cast<char*>(records.data()),
+            static_cast<std::streamsize>(records.size() * sizeof(JournalRecord))
+        );
+
+        records.resize(static_cast<unsigned long>(file.gcount()) / sizeof(JournalRecord));
+    }
+
+    unsigned long complete = records.size() * sizeof(JournalRecord);
+
+    if (complete != size) {
+        boost::filesystem::resize_file(path, complete, error);
+
+        if (error) {
+            std::printf("Failed to cut off the incomplete record in %s\n", path.c_str());
+        }
+    }
+
+    return records;
+}
+
+void Journal::Clear(const std::string &path) {
+    std::ofstream(path, std::ofstream::binary | std::ofstream::trunc);
+}
+
+bool Journal::Replace_File(const std::string &path, const std::string &contents) {
+    std::string tempPath = path + ".tmp";
+
+    std::ofstream file(tempPath, std::ofstream::binary | std::ofstream::trunc);
+    file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+    file.close();
+
+    // Without syncing first, the rename could reach the disk before the contents do.
+    if (!file.good() || !Sync_File(tempPath)) {
+        boost::system::error_code error;
+        boost::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::rename(tempPath, path, error);
+
+    return !error;
+}
+
+bool Journal::Sync_Directory(const std::string &path) {
+#ifdef _WIN32
+    // Directories can't be opened for syncing on Windows, where NTFS journals the rename itself.
+    (void)path;
+    return true;
+#else
+    return Sync_File(path);
+#endif
+}
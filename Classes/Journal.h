@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// A single block change in a world's journal.
+// A type of -1 means the block was reverted to what the world generator placed there.
+struct JournalRecord {
+    int ChunkX, ChunkY, ChunkZ;
+    int Index;
+    int Type;
+    int Data;
+    unsigned long long Sequence;
+};
+
+static_assert(sizeof(JournalRecord) == 32, "Journal records must be 32 bytes.");
+
+namespace Journal {
+    // Appends the records to the end of the journal file, and returns whether they were written.
+    bool Append(const std::string &path, const std::vector<JournalRecord> &records);
+
+    // Reads every complete record in the journal file.
+    // A record cut off by a crash is removed from the file, so that the next append starts on a record boundary.
+    std::vector<JournalRecord> Read(const std::string &path);
+
+    // Empties the journal file once its records have been compacted.
+    void Clear(const std::string &path);
+
+    // Writes a file next to the old one, syncs it to disk and renames it over the old one,
+    // so that neither a crash nor a power loss leaves a partial file.
+    // The rename itself is only durable once the directory is synced.
+    bool Replace_File(const std::string &path, const std::string &contents);
+
+    // Makes the renames in a directory durable, and returns whether that succeeded.
+    bool Sync_Directory(const std::string &path);
+}
@@ -12,6 +12,8 @@
 #include "Entity.h"
 #include "Player.h"
 #include "Shader.h"
+#include "Interface.h"
+#include "RenderQueue.h"
 
 #include <json.hpp>
 
@@ -167,20 +169,8 @@ void Network::Update_Players() {
 }
 
 void Network::Render_Players() {
-    static Buffer* buffers[6] = {
-        &HeadBuffer,     &BodyBuffer,    &LeftArmBuffer,
-        &RightArmBuffer, &LeftLegBuffer, &RightLegBuffer
-    };
-
-    static glm::vec3 translateOffsets[6] = {
-        {0, 1.5, 0}, {0, 0.75, 0}, {0, 1.50, 0},
-        {0, 1.5, 0}, {0, 0.75, 0}, {0, 0.75, 0}
-    };
-
-    static glm::vec3 scalingFactors[6] = {
-        {0.5, 0.5, 0.5}, {0.5, 0.75, 0.25}, {0.25, 0.75, 0.25},
-        {0.25, 0.75, 0.25}, {0.25, 0.75, 0.25}, {0.25, 0.75, 0.25}
-    };
+    // Each player's pose, which the shader turns into the transforms of the body parts.
+    Data instances;
 
     for (auto &player : Players) {
         PlayerChar &p = player.second;
@@ -189,40 +179,21 @@ void Network::Render_Players() {
             continue;
         }
 
-        mobShader->Upload("lightLevel", p.LightLevel);
-
-        for (int i = 0; i < 6; i++) {
-            glm::mat4 model;
-            float angle = p.MovementAngle;
-
-            if (i == 3 && p.Keys[GLFW_MOUSE_BUTTON_LEFT]) {
-                angle = p.PunchingAngle + p.Pitch;
-            }
-
-            angle = glm::radians(angle);
-
-            if (i == 2 || i == 5) {
-                angle = -angle;
-            }
+        float swing = glm::radians(p.MovementAngle);
+        float armSwing = p.Keys[GLFW_MOUSE_BUTTON_LEFT] ? glm::radians(p.PunchingAngle + p.Pitch) : swing;
 
-            model = glm::translate(model, p.Position + translateOffsets[i]);
-
-            if (i >= 2) { // Rotate body parts
-                model = glm::rotate(model, angle, p.Right);
-            }
-
-            model = glm::rotate(model, glm::radians(270.0f - p.Yaw), {0, 1, 0});
-
-            if (i == 0) { // Rotate head up/down
-                model = glm::rotate(model, glm::radians(p.Pitch), {1, 0, 0});
-            }
-
-            model = glm::scale(model, scalingFactors[i]);
+        Extend(instances, p.Position);
+        Extend(instances, p.Right);
+        Extend(instances, glm::radians(270.0f - p.Yaw), glm::radians(p.Pitch), swing, armSwing);
+        instances.push_back(static_cast<float>(p.LightLevel));
+    }
 
-            mobShader->Upload("model", model);
-            buffers[i]->Draw();
-        }
+    if (instances.empty()) {
+        return;
     }
+
+    PlayerModelBuffer.Upload_Instances(instances);
+    RenderQueue::Add(&PlayerModelBuffer);
 }
 
 void Update_Player(PlayerChar &p) {
@@ -17,6 +17,7 @@
 #include "Network.h"
 #include "Interface.h"
 #include "Inventory.h"
+#include "ChunkCache.h"
 
 #include <json.hpp>
 
@@ -25,6 +26,9 @@ const float PLAYER_RANGE = 5.0f;
 
 const float HITSCAN_STEP_SIZE = 0.1f;
 
+// Seconds of movement ahead of the player that saved chunks are read for.
+const float PREFETCH_TIME = 2.0f;
+
 const float MOVEMENT_ANGLE_START = -45.0f;
 const float MOVEMENT_ANGLE_END   =  45.0f;
 
@@ -34,6 +38,7 @@ static float PUNCHING_ANGLE_END   = 60.0f;
 static std::set<Chunk*> lightMeshingList;
 
 static glm::vec3 lastChunk(-5);
+static glm::vec3 lastPrefetchChunk(-5);
 static bool MouseDown = false;
 
 static int NumKeys[10] = {
@@ -52,6 +57,8 @@ Buffer RightArmBuffer = Buffer();
 Buffer LeftLegBuffer  = Buffer();
 Buffer RightLegBuffer = Buffer();
 
+Buffer PlayerModelBuffer = Buffer();
+
 static int PunchingAngleDirection = 200;
 static int MovementAngleDirection = 5000;
 
@@ -95,6 +102,9 @@ void Player::Init() {
     HoldingBuffer.Init(modelShader);
     HoldingBuffer.Create(3, 3);
 
+    DamageBuffer.Init(damageShader);
+    DamageBuffer.Create(3, 3);
+
     Interface::Set_Document("playerUI");
     Interface::Add_Bar("health", "HP", hpDims, hpRange);
     Interface::Set_Document("");
@@ -105,6 +115,7 @@ void Player::Init() {
 
 void Player::Init_Model() {
     mobShader->Upload("tex", PLAYER_TEXTURE_UNIT);
+    playerShader->Upload("tex", PLAYER_TEXTURE_UNIT);
 
     glActiveTexture(GL_TEXTURE0 + PLAYER_TEXTURE_UNIT);
     unsigned int texture = std::get<0>(Load_Texture("skin.png"));
@@ -120,22 +131,35 @@ void Player::Init_Model() {
     };
     std::string parts[6] = { "head", "body", "arm", "arm", "leg", "leg" };
 
+    // The whole model tags each vertex with its part, and is posed in the shader.
+    Data modelData;
+
     for (int buf = 0; buf < 6; ++buf) {
         Data data;
         buffers[buf]->Init(mobShader);
 
         for (unsigned long i = 0; i < 6; i++) {
             for (unsigned long j = 0; j < 6; j++) {
+                glm::vec2 texCoords(
+                    PlayerTexCoords.at(parts[buf])[i][static_cast<unsigned long>(tex_coords[i][j].x)].x / 64,
+                    PlayerTexCoords.at(parts[buf])[i][static_cast<unsigned long>(tex_coords[i][j].y)].y / 32
+                );
+
                 Extend(data, vertices[i][j] - offsets[buf]);
-                data.push_back(PlayerTexCoords.at(parts[buf])[i]
-                    [static_cast<unsigned long>(tex_coords[i][j].x)].x / 64);
-                data.push_back(PlayerTexCoords.at(parts[buf])[i]
-                    [static_cast<unsigned long>(tex_coords[i][j].y)].y / 32);
+                Extend(data, texCoords);
+
+                Extend(modelData, vertices[i][j] - offsets[buf]);
+                Extend(modelData, texCoords);
+                modelData.push_back(static_cast<float>(buf));
             }
         }
 
         buffers[buf]->Create(3, 2, data);
     }
+
+    PlayerModelBuffer.Init(playerShader);
+    PlayerModelBuffer.Create(3, 2, 1, modelData);
+    PlayerModelBuffer.Create_Instances({3, 3, 4, 1});
 }
 
 void Player::Init_Sounds() {
@@ -171,7 +195,29 @@ void Player::Mesh_Holding() {
 }
 
 void Player::Mesh_Damage(int index) {
-    ChunkMap[LookingChunk]->Set_Extra_Texture(LookingTile, Blocks::Get_Block(255, index + 1)->Texture);
+    DamageTexture = Blocks::Get_Block(255, index + 1)->Texture;
+
+    Data data;
+    Blocks::Mesh(data, LookingBlockType, Get_World_Pos(LookingChunk, LookingTile), 1.0f, {}, false);
+    DamageBuffer.Upload(data);
+}
+
+void Player::Draw_Damage() {
+    if (DamageTexture == 0) {
+        return;
+    }
+
+    damageShader->Upload("damageTexture", static_cast<float>(DamageTexture));
+
+    // Pull the cracks towards the camera so they don't Z-fight with the block.
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(-1.0f, -1.0f);
+    glDepthMask(GL_FALSE);
+
+    DamageBuffer.Draw();
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_POLYGON_OFFSET_FILL);
 }
 
 void Player::Draw_Model() {
@@ -471,6 +517,12 @@ void Player::Update(bool update) {
             lastChunk = CurrentChunk;
             Queue_Chunks();
         }
+
+        // Read the chunks in the direction of movement before they come into render distance.
+        if (DeltaTime > 0) {
+            glm::vec3 movement = (WorldPos - prevPos) / static_cast<float>(DeltaTime);
+            Prefetch_Chunks(Get_Chunk_Pos(WorldPos + movement * PREFETCH_TIME).first);
+        }
     }
 }
 
@@ -588,7 +640,7 @@ void Player::Place_Light(int lightLevel) {
     ChunkMap[LookingAirChunk]->LightQueue.emplace(LookingAirChunk, LookingAirTile);
 
     ChunkMap[LookingAirChunk]->Light();
-    ChunkMap[LookingAirChunk]->Mesh();
+    ChunkMap[LookingAirChunk]->Mark_Dirty(LookingAirTile);
 }
 
 void Player::Remove_Light() {
@@ -600,7 +652,7 @@ void Player::Remove_Light() {
     ChunkMap[LookingChunk]->Set_Light(LookingTile, 0);
 
     ChunkMap[LookingChunk]->Light();
-    ChunkMap[LookingChunk]->Mesh();
+    ChunkMap[LookingChunk]->Mark_Dirty(LookingTile);
 }
 
 void Player::Check_Hit() {
@@ -679,9 +731,7 @@ void Player::Check_Hit() {
 
         MouseTimer = 0;
 
-        if (Exists(prevChunk)) {
-            ChunkMap[prevChunk]->Set_Extra_Texture(prevTile, 0);
-        }
+        DamageTexture = 0;
 
         LookingBlockType = Blocks::Get_Block(
             ChunkMap[LookingChunk]->Get_Type(LookingTile),
@@ -805,7 +855,6 @@ void Player::Mouse_Handler(int posX, int posY) {
     listener.Set_Orientation(Cam.Front, Cam.Up);
 
     Check_Hit();
-    Cull_Chunks();
 }
 
 void Player::Scroll_Handler(double offsetY) {
@@ -842,9 +891,7 @@ void Player::Click_Handler(int button, int action) {
     if (!MouseDown || Creative) {
         MouseTimer = 0.0;
 
-        if (LookingAtBlock) {
-            ChunkMap[LookingChunk]->Set_Extra_Texture(LookingTile, 0);
-        }
+        DamageTexture = 0;
     }
 
     if (MouseDown && LookingAtBlock && Creative) {
@@ -953,22 +1000,6 @@ void Player::Play_Sound(std::string type, glm::vec3 chunk, glm::vec3 tile) {
     listener.Add_Sound((*sound), Get_World_Pos(chunk, tile));
 }
 
-void Player::Cull_Chunks() {
-    for (auto const &chunk : ChunkMap) {
-        if (glm::distance(CurrentChunk.xz(), chunk.first.xz()) <= 2) {
-            chunk.second->Visible = true;
-        }
-        else {
-            chunk.second->Visible = glm::degrees(
-                glm::acos(glm::dot(
-                    Cam.FrontDirection.xz(),
-                    glm::normalize(chunk.first.xz() - CurrentChunk.xz())
-                ))
-            ) <= DEFAULT_FOV;
-        }
-    }
-}
-
 void Player::Queue_Chunks(bool regenerate) {
     float startY = 3;
     float endY = -10;
@@ -982,15 +1013,24 @@ void Player::Queue_Chunks(bool regenerate) {
 		;
 	}
 
+    bool unloaded = false;
+
     for (auto chunk = ChunkMap.begin(); chunk != ChunkMap.end();) {
         float dist = glm::distance(CurrentChunk.xz(), chunk->first.xz());
         bool outOfRange = dist >= RENDER_DISTANCE || chunk->first.y > startY || chunk->first.y < endY;
 
         if (chunk->second == nullptr || regenerate || outOfRange) {
+            unloaded |= outOfRange;
+
+            if (chunk->second != nullptr) {
+                ChunkCache::Store(chunk->second);
+            }
+
             delete chunk->second;
             chunk = ChunkMap.erase(chunk);
         }
         else {
+            chunk->second->Set_LOD(Chunks::Get_LOD(dist));
             ++chunk;
         }
     }
@@ -1008,23 +1048,57 @@ void Player::Queue_Chunks(bool regenerate) {
 					continue;
 				}
 
-                auto savedData = Worlds::Load_Chunk(WORLD_NAME, pos);
-
-                if (savedData.size() > 0) {
-                    ChangedBlocks[pos] = savedData;
-                }
-                else {
-                    ChangedBlocks.erase(pos);
-                }
-
                 ChunkMap[pos] = new Chunk(pos);
-                ChunkMap[pos]->buffer.Init(shader);
-                ChunkMap[pos]->buffer.Create(3, 3, 1, 1, 1);
+                ChunkMap[pos]->LOD = Chunks::Get_LOD(glm::distance(CurrentChunk.xz(), pos.xz()));
+                ChunkMap[pos]->QueuedTime = glfwGetTime();
+
+                // Chunks that were read ahead are ready right away, the rest wait for the I/O threads.
+                ChunkMap[pos]->Loaded = false;
+                Chunks::Receive_Changes(ChunkMap[pos]);
             }
         }
     }
 
+    Worlds::Discard_Loads(CurrentChunk, static_cast<float>(RENDER_DISTANCE * 2));
+
 	ChunkMapBusy.clear(std::memory_order_release);
+
+    // Write the changes of unloaded chunks without waiting for the next save interval.
+    if (unloaded) {
+        Worlds::Flush_Journal();
+    }
+}
+
+void Player::Prefetch_Chunks(glm::vec3 aheadChunk) {
+    if (aheadChunk == lastPrefetchChunk || aheadChunk.xz() == CurrentChunk.xz()) {
+        return;
+    }
+
+    lastPrefetchChunk = aheadChunk;
+
+    float startY = 3;
+    float endY = -10;
+
+    if (aheadChunk.y <= -6) {
+        startY = aheadChunk.y + 3;
+        endY = aheadChunk.y - 3;
+    }
+
+    for (float x = aheadChunk.x - RENDER_DISTANCE; x <= aheadChunk.x + RENDER_DISTANCE; x++) {
+        for (float z = aheadChunk.z - RENDER_DISTANCE; z <= aheadChunk.z + RENDER_DISTANCE; z++) {
+            glm::vec2 pos(x, z);
+
+            // Chunks in render distance are already being read.
+            if (glm::distance(aheadChunk.xz(), pos) >= RENDER_DISTANCE ||
+                glm::distance(CurrentChunk.xz(), pos) < RENDER_DISTANCE) {
+                continue;
+            }
+
+            for (float y = startY; y >= endY; y--) {
+                Worlds::Prefetch_Chunk(WORLD_NAME, glm::ivec3(x, y, z));
+            }
+        }
+    }
 }
 
 void Player::Request_Handler(std::string packet, bool sending) {
@@ -1064,7 +1138,7 @@ void Player::Request_Handler(std::string packet, bool sending) {
             }
             else {
                 ChangedBlocks[chunk][tile] = {0, 0};
-                Worlds::Save_Chunk(WORLD_NAME, chunk);
+                Worlds::Save_Block(WORLD_NAME, chunk, tile);
             }
         }
 
@@ -1089,12 +1163,12 @@ void Player::Request_Handler(std::string packet, bool sending) {
                     ChunkMap[chunk]->LightQueue.emplace(chunk, tile);
 
                     ChunkMap[chunk]->Light();
-                    ChunkMap[chunk]->Mesh();
+                    ChunkMap[chunk]->Mark_Dirty(tile);
                 }
             }
             else {
                 ChangedBlocks[chunk][tile] = {type, typeData};
-                Worlds::Save_Chunk(WORLD_NAME, chunk);
+                Worlds::Save_Block(WORLD_NAME, chunk, tile);
             }
         }
 
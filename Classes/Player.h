@@ -17,6 +17,9 @@ extern Buffer RightArmBuffer;
 extern Buffer LeftLegBuffer;
 extern Buffer RightLegBuffer;
 
+// Every body part in one buffer, drawn once per remote player.
+extern Buffer PlayerModelBuffer;
+
 typedef std::vector<float> Data;
 
 struct Block;
@@ -46,6 +49,7 @@ class Player {
 
     void Mesh_Holding();
     void Mesh_Damage(int index);
+    void Draw_Damage();
 
     void Move();
 
@@ -57,6 +61,9 @@ class Player {
     void Teleport(glm::vec3 pos);
 
     void Queue_Chunks(bool regenerate = false);
+
+    // Starts reading the saved chunks around where the player is headed.
+    void Prefetch_Chunks(glm::vec3 aheadChunk);
     void Load_Data(const std::string data);
     void Clear_Keys();
 
@@ -83,6 +90,10 @@ class Player {
     float Rotation;
     float MouseTimer = 0.0f;
 
+    // Texture layer of the cracks drawn over the block being broken, 0 if there are none.
+    int DamageTexture = 0;
+    Buffer DamageBuffer;
+
     glm::vec3 Velocity;
 
     void Init_Model();
@@ -102,6 +113,4 @@ class Player {
 
     void Place_Light(int lightLevel);
     void Remove_Light();
-
-    void Cull_Chunks();
 };
@@ -0,0 +1,33 @@
+#include "RenderQueue.h"
+
+#include <tuple>
+#include <algorithm>
+
+#include "Shader.h"
+
+struct DrawCommand {
+    Buffer* DrawBuffer;
+
+    // Kept here so that sorting doesn't need to look inside the buffers.
+    unsigned int Program;
+    unsigned int VAO;
+};
+
+static std::vector<DrawCommand> Commands;
+
+void RenderQueue::Add(Buffer* buffer) {
+    Commands.push_back({buffer, buffer->BufferShader->Program, buffer->Get_VAO()});
+}
+
+void RenderQueue::Flush() {
+    // Textures are bound once to fixed units, so only the shader and vertex array need sorting.
+    std::stable_sort(Commands.begin(), Commands.end(), [](const DrawCommand &a, const DrawCommand &b) {
+        return std::tie(a.Program, a.VAO) < std::tie(b.Program, b.VAO);
+    });
+
+    for (auto const &command : Commands) {
+        command.DrawBuffer->Draw();
+    }
+
+    Commands.clear();
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "Buffer.h"
+
+namespace RenderQueue {
+    // Queues a buffer to be drawn this frame. Per-draw data goes in the buffer's instance attributes.
+    void Add(Buffer* buffer);
+
+    // Draws every queued buffer, sorted so that draws sharing a shader and vertex array are next to each other.
+    void Flush();
+}
@@ -1,36 +1,162 @@
 #include "Shader.h"
 
+#include <vector>
 #include <fstream>
-#include <sstream>
+
+#include <boost/filesystem.hpp>
+
+int DrawStateCalls = 0;
+int LastFrameDrawStateCalls = 0;
+
+unsigned int Shader::CurrentProgram = 0;
+
+// Cached program binaries start with this header, followed by the binary itself.
+struct ProgramCacheHeader {
+    char Magic[4];
+    int Version;
+
+    // Hash of the shader sources and the driver that compiled them.
+    unsigned long long Key;
+
+    int Format;
+    int Length;
+};
+
+static const int PROGRAM_CACHE_VERSION = 1;
+
+// 64-bit FNV-1a.
+static unsigned long long Hash(const std::string &data, unsigned long long hash = 14695981039346656037ULL) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+static std::string Get_Driver() {
+    std::string driver;
+
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+        const GLubyte* value = glGetString(name);
+
+        if (value != nullptr) {
+            driver += reinterpret_cast<const char*>(value);
+        }
+
+        driver += '\n';
+    }
+
+    return driver;
+}
 
 Shader::Shader(const char *shader) {
     std::string vPath = "Shaders/" + std::string(shader) + ".vert";
     std::string fPath = "Shaders/" + std::string(shader) + ".frag";
+    std::string cachePath = "Cache/Shaders/" + std::string(shader) + ".bin";
+
+    std::string vSource = Load_File(vPath);
+    std::string fSource = Load_File(fPath);
+
+    static const std::string driver = Get_Driver();
+    unsigned long long key = Hash(driver, Hash(fSource, Hash(vSource)));
 
-    Add_Shader(vShader, "VERTEX", vPath);
-    Add_Shader(fShader, "FRAGMENT", fPath);
-    Link();
+    if (Load_Binary(cachePath, key)) {
+        glDeleteShader(vShader);
+        glDeleteShader(fShader);
+        return;
+    }
+
+    Add_Shader(vShader, "VERTEX", vPath, vSource);
+    Add_Shader(fShader, "FRAGMENT", fPath, fSource);
+
+    glProgramParameteri(Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    if (Link()) {
+        Save_Binary(cachePath, key);
+    }
 }
 
 std::string Shader::Load_File(std::string path) {
-    std::ifstream file(path);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+
+    if (!file) {
+        return "ERROR";
+    }
+
+    std::string contents(static_cast<size_t>(file.tellg()), '\0');
+
+    file.seekg(0);
+    file.read(&contents[0], static_cast<std::streamsize>(contents.size()));
+
+    return contents;
+}
+
+bool Shader::Load_Binary(std::string path, unsigned long long key) {
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file) {
+        return false;
+    }
+
+    ProgramCacheHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!file || std::memcmp(header.Magic, "CMPB", 4) != 0 || header.Version != PROGRAM_CACHE_VERSION ||
+        header.Key != key || header.Length <= 0) {
+        return false;
+    }
+
+    std::vector<char> binary(static_cast<size_t>(header.Length));
+    file.read(binary.data(), header.Length);
+
+    if (!file) {
+        return false;
+    }
+
+    // The driver may still reject the binary, for example after an update that kept its version string.
+    glProgramBinary(Program, static_cast<GLenum>(header.Format), binary.data(), header.Length);
+
+    int success;
+    glGetProgramiv(Program, GL_LINK_STATUS, &success);
+
+    return success != 0;
+}
 
-    if (file) {
-        std::ostringstream contents;
-        contents << file.rdbuf();
-        file.close();
+void Shader::Save_Binary(std::string path, unsigned long long key) {
+    int length = 0;
+    glGetProgramiv(Program, GL_PROGRAM_BINARY_LENGTH, &length);
 
-        return contents.str().c_str();
+    // Drivers without any binary formats report no length.
+    if (length <= 0) {
+        return;
     }
 
-    return "ERROR";
+    ProgramCacheHeader header = {{'C', 'M', 'P', 'B'}, PROGRAM_CACHE_VERSION, key, 0, 0};
+    std::vector<char> binary(static_cast<size_t>(length));
+
+    GLenum format;
+    glGetProgramBinary(Program, length, &header.Length, &format, binary.data());
+    header.Format = static_cast<int>(format);
+
+    boost::system::error_code error;
+    boost::filesystem::create_directories(boost::filesystem::path(path).parent_path(), error);
+
+    // Write to a temporary file first, so that a partial binary is never loaded.
+    std::ofstream file(path + ".tmp", std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), header.Length);
+    file.close();
+
+    if (file.good()) {
+        boost::filesystem::rename(path + ".tmp", path, error);
+    }
 }
 
-void Shader::Add_Shader(unsigned int shader, std::string type, std::string path) {
-    std::string shaderString = Load_File(path);
-    const char* shaderCode = shaderString.c_str();
+void Shader::Add_Shader(unsigned int shader, std::string type, std::string path, const std::string &source) {
+    const char* shaderCode = source.c_str();
 
-    if (strcmp(shaderCode, "ERROR") == 0) {
+    if (source == "ERROR") {
         std::cout << "ERROR::SHADER::" << type << "::FILE_NOT_SUCCESSFULLY_READ\n" << path << std::endl;
     }
 
@@ -50,7 +176,7 @@ void Shader::Add_Shader(unsigned int shader, std::string type, std::string path)
     glAttachShader(Program, shader);
 }
 
-void Shader::Link() {
+bool Shader::Link() {
     int success;
     char infoLog[512];
 
@@ -65,6 +191,8 @@ void Shader::Link() {
 
     glDeleteShader(vShader);
     glDeleteShader(fShader);
+
+    return success != 0;
 }
 
 int Shader::Get_Location(const std::string name) {
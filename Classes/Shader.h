@@ -2,6 +2,8 @@
 
 #include <map>
 #include <string>
+#include <vector>
+#include <cstring>
 #include <iostream>
 
 #include <GL/glew.h>
@@ -11,37 +13,85 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// Program and vertex array binds, changed uniform uploads and draws this frame, and during the last whole frame.
+// Buffer uploads, texture binds and other state changes aren't counted.
+extern int DrawStateCalls;
+extern int LastFrameDrawStateCalls;
+
+// The last value uploaded to a uniform location, up to the size of a mat4.
+struct CachedUniform {
+    unsigned char Size = 0;
+    unsigned char Value[sizeof(glm::mat4)];
+};
+
 class Shader {
 public:
     unsigned int Program = glCreateProgram();
 
+    // Loads the program from the binary cache if it was built from the same sources by the same driver,
+    // and otherwise compiles it and caches the result.
     Shader(const char *shader);
-    void Add_Shader(unsigned int shader, std::string type, std::string path);
+    void Add_Shader(unsigned int shader, std::string type, std::string path, const std::string &source);
 
-    void Link();
+    bool Link();
 
-    inline void Bind() { glUseProgram(Program); }
-    inline void Unbind() { glUseProgram(0); }
+    // Programs are left bound after drawing, so binding the same one again is skipped.
+    inline void Bind() {
+        if (CurrentProgram != Program) {
+            glUseProgram(Program);
+            CurrentProgram = Program;
+            ++DrawStateCalls;
+        }
+    }
+    inline void Unbind() {
+        glUseProgram(0);
+        CurrentProgram = 0;
+        ++DrawStateCalls;
+    }
 
     int Get_Location(const std::string name);
 
     inline void Upload(const std::string &name, const int &input) {
-        glProgramUniform1i(Program, Get_Location(name), input);
+        int location = Get_Location(name);
+
+        if (Changed(location, input)) {
+            glProgramUniform1i(Program, location, input);
+        }
     }
     inline void Upload(const std::string &name, const float &input) {
-        glProgramUniform1f(Program, Get_Location(name), input);
+        int location = Get_Location(name);
+
+        if (Changed(location, input)) {
+            glProgramUniform1f(Program, location, input);
+        }
     }
     inline void Upload(const std::string &name, const glm::vec2 &input) {
-        glProgramUniform2f(Program, Get_Location(name), input.x, input.y);
+        int location = Get_Location(name);
+
+        if (Changed(location, input)) {
+            glProgramUniform2f(Program, location, input.x, input.y);
+        }
     }
     inline void Upload(const std::string &name, const glm::vec3 &input) {
-        glProgramUniform3f(Program, Get_Location(name), input.x, input.y, input.z);
+        int location = Get_Location(name);
+
+        if (Changed(location, input)) {
+            glProgramUniform3f(Program, location, input.x, input.y, input.z);
+        }
     }
     inline void Upload(const std::string &name, const glm::vec4 &input) {
-        glProgramUniform4f(Program, Get_Location(name), input.x, input.y, input.z, input.w);
+        int location = Get_Location(name);
+
+        if (Changed(location, input)) {
+            glProgramUniform4f(Program, location, input.x, input.y, input.z, input.w);
+        }
     }
     inline void Upload(const std::string &name, const glm::mat4 &input) {
-        glProgramUniformMatrix4fv(Program, Get_Location(name), 1, false, glm::value_ptr(input));
+        int location = Get_Location(name);
+
+        if (Changed(location, input)) {
+            glProgramUniformMatrix4fv(Program, location, 1, false, glm::value_ptr(input));
+        }
     }
 
 private:
@@ -50,5 +100,40 @@ private:
 
     std::map<std::string, int> UniformLocations;
 
+    // Indexed by uniform location.
+    std::vector<CachedUniform> UniformCache;
+
+    static unsigned int CurrentProgram;
+
+    // Remembers the value of a uniform, and returns whether it differs from the last one uploaded.
+    // Uniforms that aren't in the program have no location, and uploading them does nothing.
+    template <typename T>
+    inline bool Changed(int location, const T &value) {
+        static_assert(sizeof(T) <= sizeof(CachedUniform::Value), "Uniform values are cached up to a mat4.");
+
+        if (location < 0) {
+            return false;
+        }
+
+        if (static_cast<unsigned long>(location) >= UniformCache.size()) {
+            UniformCache.resize(static_cast<unsigned long>(location) + 1);
+        }
+
+        CachedUniform &cached = UniformCache[static_cast<unsigned long>(location)];
+
+        if (cached.Size == sizeof(T) && std::memcmp(cached.Value, &value, sizeof(T)) == 0) {
+            return false;
+        }
+
+        std::memcpy(cached.Value, &value, sizeof(T));
+        cached.Size = sizeof(T);
+
+        ++DrawStateCalls;
+        return true;
+    }
+
     std::string Load_File(std::string path);
+
+    bool Load_Binary(std::string path, unsigned long long key);
+    void Save_Binary(std::string path, unsigned long long key);
 };
@@ -5,15 +5,18 @@
 #include "Chunk.h"
 #include "Blocks.h"
 #include "Player.h"
+#include "Shader.h"
 #include "System.h"
 #include "Worlds.h"
 #include "Network.h"
 #include "Interface.h"
 #include "Inventory.h"
+#include "ChunkCache.h"
 
 #include <fstream>
 #include <numeric>
 #include <iostream>
+#include <algorithm>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -23,10 +26,15 @@
 const int AVG_UPDATE_RANGE = 10;
 const double UI_UPDATE_FREQUENCY = 1.0;
 
+// Frame times are kept for this many frames, and sorted into buckets with these upper limits in milliseconds.
+const unsigned long FRAME_HISTORY = 300;
+const double FRAME_BUCKETS[4] = {8.3, 16.7, 33.3, 50.0};
+
 const std::string FONT = "Roboto";
 
 static double lastUIUpdate;
 static std::deque<int> CPU;
+static std::deque<double> FrameTimes;
 
 bool UI::ShowDebug        = false;
 bool UI::ShowTitle        = true;
@@ -331,7 +339,7 @@ void Init_Options() {
     glm::vec4 fovDims(Scale(840, 700), buttonSize);
     glm::vec4 mipmapDims(Scale(400, 600), buttonSize);
 
-    glm::vec3 renderDistRange(1, 20, RENDER_DISTANCE);
+    glm::vec3 renderDistRange(1, 32, RENDER_DISTANCE);
     glm::vec3 afRange(1, 16, ANISOTROPIC_FILTERING);
     glm::vec3 mipmapRange(0, 4, MIPMAP_LEVEL);
     glm::vec3 fovRange(10, 180, FOV);
@@ -511,6 +519,15 @@ void Init_Debug() {
     Interface::Add_Text("ram",         "RAM: " + ramUsage,  Scale(30, 790));
     Interface::Add_Text("chunkQueue",  "Chunks Loaded: ",   Scale(30, 760));
     Interface::Add_Text("vertQueue",   "Vertices Loaded: ", Scale(30, 730));
+    Interface::Add_Text("remeshes",    "Remeshes: ",        Scale(30, 700));
+    Interface::Add_Text("lodVertices", "LOD Vertices: ",    Scale(30, 670));
+    Interface::Add_Text("drawnChunks", "Chunks Drawn: ",    Scale(30, 640));
+    Interface::Add_Text("drawCalls",   "Draw Calls: ",      Scale(30, 610));
+    Interface::Add_Text("stateCalls",  "Draw State Calls: ", Scale(30, 580));
+    Interface::Add_Text("frameTimes",  "Frame Times: ",     Scale(30, 550));
+    Interface::Add_Text("saves",       "Journal: ",         Scale(30, 520));
+    Interface::Add_Text("chunkCache",  "Chunk Cache: ",     Scale(30, 490));
+    Interface::Add_Text("cacheMemory", "Cache Memory: ",    Scale(30, 460));
 
     Interface::Set_Document("");
 }
@@ -587,6 +604,48 @@ void Toggle_Video_Options(void* caller) {
     UI::ShowVideoOptions = !UI::ShowVideoOptions;
 }
 
+std::string Get_LOD_Vertices() {
+    int vertices[LOD_LEVELS] = {0};
+
+    for (auto const &chunk : ChunkMap) {
+        if (chunk.second->Visible) {
+            vertices[chunk.second->LOD] += chunk.second->Vertices;
+        }
+    }
+
+    std::string text = "LOD Vertices:";
+
+    for (int lod = 0; lod < LOD_LEVELS; ++lod) {
+        text += " " + std::to_string(vertices[lod]);
+    }
+
+    return text;
+}
+
+std::string Get_Frame_Histogram() {
+    int counts[5] = {0};
+    double worst = 0.0;
+
+    for (double const &time : FrameTimes) {
+        int bucket = 0;
+
+        while (bucket < 4 && time >= FRAME_BUCKETS[bucket]) {
+            ++bucket;
+        }
+
+        ++counts[bucket];
+        worst = std::max(worst, time);
+    }
+
+    std::string text = "Frame Times (<8/<17/<33/<50/50+ ms):";
+
+    for (int const &count : counts) {
+        text += " " + std::to_string(count);
+    }
+
+    return text + ", worst " + std::to_string(static_cast<int>(worst)) + " ms";
+}
+
 std::tuple<int, int> Get_Loaded() {
     int total = 0;
     int vertices = 0;
@@ -595,7 +654,7 @@ std::tuple<int, int> Get_Loaded() {
         total += chunk.second->Meshed;
 
         if (chunk.second->Visible) {
-            vertices += chunk.second->buffer.Vertices;
+            vertices += chunk.second->Vertices;
         }
     }
 
@@ -609,6 +668,12 @@ void Draw_Debug() {
         CPU.pop_front();
     }
 
+    FrameTimes.push_back(DeltaTime * 1000.0);
+
+    if (FrameTimes.size() > FRAME_HISTORY) {
+        FrameTimes.pop_front();
+    }
+
     Interface::Set_Document("debug");
 
     if (LastFrame - lastUIUpdate >= UI_UPDATE_FREQUENCY) {
@@ -637,6 +702,55 @@ void Draw_Debug() {
 
     Interface::Get_Text_Element("vertQueue")->Set_Text("Vertices Loaded: " + std::to_string(loadedVertices));
 
+    int remeshRequests, coalescedRemeshes, executedRemeshes;
+    std::tie(remeshRequests, coalescedRemeshes, executedRemeshes) = Chunks::Get_Remesh_Stats();
+
+    Interface::Get_Text_Element("lodVertices")->Set_Text(Get_LOD_Vertices());
+
+    int frustumChunks, drawnChunks;
+    std::tie(frustumChunks, drawnChunks) = Chunks::Get_Cull_Stats();
+
+    Interface::Get_Text_Element("drawnChunks")->Set_Text(
+        "Chunks Drawn: " + std::to_string(drawnChunks) + " (" + std::to_string(frustumChunks) + " in view)"
+    );
+
+    Interface::Get_Text_Element("drawCalls")->Set_Text("Draw Calls: " + std::to_string(Chunks::Get_Draw_Calls()));
+    Interface::Get_Text_Element("stateCalls")->Set_Text("Draw State Calls: " + std::to_string(LastFrameDrawStateCalls));
+    Interface::Get_Text_Element("frameTimes")->Set_Text(Get_Frame_Histogram());
+
+    double saveTime;
+    int savedRecords, journalRecords;
+    std::tie(saveTime, savedRecords, journalRecords) = Worlds::Get_Save_Stats();
+
+    Interface::Get_Text_Element("saves")->Set_Text(
+        "Journal: " + std::to_string(savedRecords) + " edits (" + std::to_string(journalRecords) +
+        " uncompacted, " + std::to_string(static_cast<int>(saveTime)) + " ms on main thread)"
+    );
+
+    int restoredChunks, generatedChunks;
+    double restoredTime, generatedTime;
+    std::tie(restoredChunks, generatedChunks, restoredTime, generatedTime) = ChunkCache::Get_Stats();
+
+    Interface::Get_Text_Element("chunkCache")->Set_Text(
+        "Chunk Cache: " + std::to_string(restoredChunks) + " restored, " + std::to_string(generatedChunks) +
+        " generated, visible after " + std::to_string(static_cast<int>(restoredTime)) + " / " +
+        std::to_string(static_cast<int>(generatedTime)) + " ms"
+    );
+
+    int cacheHits, cacheMisses, cachedChunks;
+    long cacheSize;
+    std::tie(cacheHits, cacheMisses, cachedChunks, cacheSize) = ChunkCache::Get_Memory_Stats();
+
+    Interface::Get_Text_Element("cacheMemory")->Set_Text(
+        "Cache Memory: " + std::to_string(cacheHits) + " hits, " + std::to_string(cacheMisses) + " misses, " +
+        std::to_string(cachedChunks) + " chunks in " + std::to_string(cacheSize / 1024) + " KB"
+    );
+
+    Interface::Get_Text_Element("remeshes")->Set_Text(
+        "Remeshes: " + std::to_string(executedRemeshes) + " (" + std::to_string(remeshRequests) +
+        " requested, " + std::to_string(coalescedRemeshes) + " coalesced)"
+    );
+
     Interface::Set_Document("");
     Interface::Draw_Document("debug");
 }
@@ -694,13 +808,13 @@ void Change_FOV(void* caller) {
         return;
     }
 
-    glm::mat4 projection = glm::perspective(
+    Cam.Projection = glm::perspective(
         glm::radians(static_cast<float>(FOV)),
         static_cast<float>(SCREEN_WIDTH) / SCREEN_HEIGHT,
         Z_NEAR_LIMIT, Z_FAR_LIMIT
     );
 
-    UBO.Upload(1, projection);
+    UBO.Upload(1, Cam.Projection);
 }
 
 void Change_Mipmap_Level(void* caller) {
@@ -4,20 +4,90 @@
 #include "Chunk.h"
 #include "Camera.h"
 #include "Player.h"
+#include "Journal.h"
 #include "Network.h"
 #include "Interface.h"
 #include "Inventory.h"
 
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <thread>
 #include <fstream>
 #include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
 
 #include <dirent.h>
 #include <json.hpp>
 
+#include <GLFW/glfw3.h>
 #include <boost/filesystem.hpp>
 
+// Seconds between the save thread's writes.
+const int SAVE_INTERVAL = 2;
+
+// The journal is folded into the chunk files once it holds this many records.
+const int JOURNAL_COMPACT_RECORDS = 4096;
+
+// Number of threads that read chunk files.
+const int IO_THREADS = 2;
+
+typedef std::map<glm::vec3, std::pair<int, int>, VectorComparator> ChunkChanges;
+
+// A task for the I/O threads, and the chunk it reads if it's a chunk load.
+struct IOTask {
+    std::function<void()> Run;
+
+    bool ChunkLoad;
+    glm::vec3 Position;
+};
+
 static std::map<std::string, int> WorldList;
 
+// The world whose journal is open, and its records that haven't been compacted yet, by chunk.
+// Loading a chunk replays these on top of its chunk file.
+static std::string JournalWorld;
+static std::map<glm::vec3, std::vector<JournalRecord>, VectorComparator> JournalIndex;
+
+// Records waiting to be appended to the journal.
+static std::vector<JournalRecord> UnwrittenRecords;
+
+static unsigned long long NextSequence = 1;
+static unsigned long long WrittenSequence = 0;
+static int JournalSize = 0;
+
+// Counts the times records were dropped from JournalIndex, so that chunk reads can tell the file may have changed.
+static unsigned long long CompactGeneration = 0;
+
+// SaveMutex guards the state above, and CompactMutex is held while writing the journal or chunk files.
+// CompactMutex is always locked first.
+static std::mutex SaveMutex;
+static std::mutex CompactMutex;
+static std::condition_variable SaveCondition;
+static std::thread SaveThread;
+
+static bool FlushRequested = false;
+static bool StopRequested  = false;
+
+static int RecordsWritten = 0;
+static double MainThreadIOTime = 0.0;
+
+// Chunks being read or already read by the I/O threads, for the world in LoadWorld.
+static std::string LoadWorld;
+static std::map<glm::vec3, std::shared_future<ChunkChanges>, VectorComparator> ChunkLoads;
+
+static std::mutex LoadMutex;
+static std::condition_variable LoadCondition;
+static std::deque<IOTask> LoadTasks;
+static std::vector<std::thread> IOThreads;
+
+static bool StopLoading = false;
+
 int Hex_To_Dec(std::string hex) {
     int result;
     std::stringstream ss;
@@ -30,12 +100,6 @@ int Hex_To_Dec(const char hex) {
     return Hex_To_Dec(std::string(1, hex));
 }
 
-std::string Dec_To_Hex(int dec) {
-    std::stringstream ss;
-    ss << std::hex << dec;
-    return ss.str();
-}
-
 int Worlds::Get_Seed(std::string name) {
     if (WorldList.count(name)) {
         return WorldList[name];
@@ -69,6 +133,22 @@ void Worlds::Create_World(std::string name, int seed) {
 }
 
 void Worlds::Delete_World(std::string name) {
+    std::lock_guard<std::mutex> compactLock(CompactMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(SaveMutex);
+
+        if (JournalWorld == name) {
+            JournalWorld = "";
+            JournalIndex.clear();
+            UnwrittenRecords.clear();
+            WrittenSequence = NextSequence - 1;
+            JournalSize = 0;
+            ++CompactGeneration;
+        }
+    }
+
+    SaveCondition.notify_all();
     boost::filesystem::remove_all("Worlds/" + name);
 }
 
@@ -98,6 +178,8 @@ void Worlds::Save_World() {
         };
     }
 
+    Flush_Journal();
+
     if (Multiplayer) {
         playerData["event"] = "save";
         Network::Send(playerData.dump());
@@ -161,40 +243,50 @@ std::vector<World> Worlds::Get_Worlds() {
     return worlds;
 }
 
-void Worlds::Save_Chunk(std::string world, glm::vec3 chunkPos) {
-    if (!ChangedBlocks.count(chunkPos)) {
-        return;
-    }
+static std::string Get_Chunk_Path(std::string world, glm::ivec3 pos) {
+    return "Worlds/" + world + "/Chunks/" +
+           std::to_string(pos.x) + "," + std::to_string(pos.y) + "," + std::to_string(pos.z) + ".chunk";
+}
 
-    glm::ivec3 pos = static_cast<glm::ivec3>(chunkPos);
+static std::string Get_Journal_Path(std::string world) {
+    return "Worlds/" + world + "/Journal.bin";
+}
+
+static void Append_Hex(std::string &out, int value) {
+    char buffer[16];
+    int length = std::snprintf(buffer, sizeof(buffer), "%x", value);
+    out.append(buffer, static_cast<unsigned long>(length));
+}
 
-    std::string fileName(std::to_string(pos.x) + "," + std::to_string(pos.y) + "," + std::to_string(pos.z) + ".chunk");
-    std::ofstream file("Worlds/" + world + "/Chunks/" + fileName, std::ofstream::trunc);
+static std::string Serialize_Chunk(const std::map<glm::vec3, std::pair<int, int>, VectorComparator> &changedBlocks) {
+    std::string contents;
 
-    for (auto const &block : ChangedBlocks[chunkPos]) {
+    for (auto const &block : changedBlocks) {
         glm::ivec3 blockPos = static_cast<glm::ivec3>(block.first);
-        file << Dec_To_Hex(blockPos.x) << Dec_To_Hex(blockPos.y) << Dec_To_Hex(blockPos.z);
+
+        Append_Hex(contents, blockPos.x);
+        Append_Hex(contents, blockPos.y);
+        Append_Hex(contents, blockPos.z);
 
         if (block.second.first > 0) {
-            file << std::hex << block.second.first;
+            Append_Hex(contents, block.second.first);
         }
 
-        file << ':';
+        contents += ':';
 
         if (block.second.second > 0) {
-
-            file << std::hex << block.second.second;
+            Append_Hex(contents, block.second.second);
         }
 
-        file << '-';
+        contents += '-';
     }
+
+    return contents;
 }
 
-std::map<glm::vec3, std::pair<int, int>, VectorComparator> Worlds::Load_Chunk(std::string world, glm::ivec3 pos) {
+static std::map<glm::vec3, std::pair<int, int>, VectorComparator> Read_Chunk(const std::string &path) {
     std::map<glm::vec3, std::pair<int, int>, VectorComparator> changedBlocks;
-
-    std::string fileName(std::to_string(pos.x) + "," + std::to_string(pos.y) + "," + std::to_string(pos.z) + ".chunk");
-    std::ifstream file("Worlds/" + world + "/Chunks/" + fileName);
+    std::ifstream file(path);
 
     if (!file.good()) {
         return changedBlocks;
@@ -215,11 +307,426 @@ std::map<glm::vec3, std::pair<int, int>, VectorComparator> Worlds::Load_Chunk(st
         }
 
         if (b.back() != ':') {
-            blockType.second = Hex_To_Dec(b.substr(b.find(':')));
+            blockType.second = Hex_To_Dec(b.substr(b.find(':') + 1));
         }
 
         changedBlocks[blockPos] = blockType;
     }
 
     return changedBlocks;
-}
\ No newline at end of file
+}
+
+static void Apply_Record(
+    std::map<glm::vec3, std::pair<int, int>, VectorComparator> &changedBlocks, const JournalRecord &record
+) {
+    glm::vec3 tile(
+        record.Index / (CHUNK_SIZE * CHUNK_SIZE), (record.Index / CHUNK_SIZE) % CHUNK_SIZE, record.Index % CHUNK_SIZE
+    );
+
+    if (record.Type < 0) {
+        changedBlocks.erase(tile);
+    }
+    else {
+        changedBlocks[tile] = std::make_pair(record.Type, record.Data);
+    }
+}
+
+// Appends the unwritten records to the journal, and returns the number of records in it.
+// Requires CompactMutex.
+static int Append_Journal() {
+    std::vector<JournalRecord> records;
+    std::string world;
+
+    {
+        std::lock_guard<std::mutex> lock(SaveMutex);
+        records.swap(UnwrittenRecords);
+        world = JournalWorld;
+    }
+
+    if (!records.empty()) {
+        Journal::Append(Get_Journal_Path(world), records);
+    }
+
+    std::lock_guard<std::mutex> lock(SaveMutex);
+
+    if (!records.empty()) {
+        WrittenSequence = records.back().Sequence;
+        RecordsWritten += static_cast<int>(records.size());
+        JournalSize += static_cast<int>(records.size());
+    }
+
+    return JournalSize;
+}
+
+// Folds the written journal records into the chunk files, and then empties the journal.
+// The journal is only emptied once the chunk files are on the disk, so a crash or power loss in between
+// only means the same records are replayed again, which leaves the same result.
+// Requires CompactMutex.
+static void Compact_Journal() {
+    std::map<glm::vec3, std::vector<JournalRecord>, VectorComparator> chunks;
+    std::string world;
+    unsigned long long lastSequence;
+
+    {
+        std::lock_guard<std::mutex> lock(SaveMutex);
+        chunks = JournalIndex;
+        world = JournalWorld;
+        lastSequence = WrittenSequence;
+    }
+
+    if (world.empty() || chunks.empty()) {
+        return;
+    }
+
+    for (auto const &chunk : chunks) {
+        std::string path = Get_Chunk_Path(world, static_cast<glm::ivec3>(chunk.first));
+        auto changedBlocks = Read_Chunk(path);
+
+        for (JournalRecord const &record : chunk.second) {
+            if (record.Sequence <= lastSequence) {
+                Apply_Record(changedBlocks, record);
+            }
+        }
+
+        if (!Journal::Replace_File(path, Serialize_Chunk(changedBlocks))) {
+            std::printf("Failed to compact chunk %s, keeping the journal\n", path.c_str());
+            return;
+        }
+    }
+
+    if (!Journal::Sync_Directory("Worlds/" + world + "/Chunks")) {
+        std::printf("Failed to sync the chunk files of %s, keeping the journal\n", world.c_str());
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(SaveMutex);
+
+    for (auto chunk = JournalIndex.begin(); chunk != JournalIndex.end();) {
+        std::vector<JournalRecord> &records = chunk->second;
+
+        records.erase(std::remove_if(records.begin(), records.end(), [lastSequence](const JournalRecord &record) {
+            return record.Sequence <= lastSequence;
+        }), records.end());
+
+        chunk = records.empty() ? JournalIndex.erase(chunk) : std::next(chunk);
+    }
+
+    ++CompactGeneration;
+
+    // Every written record has been compacted, and the rest are still waiting to be appended.
+    Journal::Clear(Get_Journal_Path(world));
+    JournalSize = 0;
+}
+
+static void Save_Thread() {
+    std::unique_lock<std::mutex> lock(SaveMutex);
+
+    while (true) {
+        SaveCondition.wait_for(lock, std::chrono::seconds(SAVE_INTERVAL), [] {
+            return FlushRequested || StopRequested;
+        });
+
+        FlushRequested = false;
+        bool stopping = StopRequested;
+        lock.unlock();
+
+        {
+            std::lock_guard<std::mutex> compactLock(CompactMutex);
+
+            if (Append_Journal() >= JOURNAL_COMPACT_RECORDS || stopping) {
+                Compact_Journal();
+            }
+        }
+
+        lock.lock();
+        SaveCondition.notify_all();
+
+        if (stopping) {
+            break;
+        }
+    }
+}
+
+// Makes the world's journal the open one, compacting the previous world's journal first,
+// and reads back records left from a session that didn't compact them.
+static void Open_Journal(const std::string &world) {
+    {
+        std::lock_guard<std::mutex> lock(SaveMutex);
+
+        if (JournalWorld == world) {
+            return;
+        }
+    }
+
+    std::lock_guard<std::mutex> compactLock(CompactMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(SaveMutex);
+
+        if (JournalWorld == world) {
+            return;
+        }
+    }
+
+    Append_Journal();
+    Compact_Journal();
+
+    std::vector<JournalRecord> records = Journal::Read(Get_Journal_Path(world));
+
+    std::lock_guard<std::mutex> lock(SaveMutex);
+
+    JournalWorld = world;
+    JournalIndex.clear();
+    UnwrittenRecords.clear();
+    ++CompactGeneration;
+
+    unsigned long long lastSequence = 0;
+
+    for (JournalRecord const &record : records) {
+        JournalIndex[glm::vec3(record.ChunkX, record.ChunkY, record.ChunkZ)].push_back(record);
+        lastSequence = std::max(lastSequence, record.Sequence);
+    }
+
+    NextSequence = lastSequence + 1;
+    WrittenSequence = lastSequence;
+    JournalSize = static_cast<int>(records.size());
+
+    if (!SaveThread.joinable()) {
+        StopRequested = false;
+        SaveThread = std::thread(Save_Thread);
+    }
+}
+
+void Worlds::Save_Block(std::string world, glm::vec3 chunkPos, glm::vec3 tile) {
+    double startTime = glfwGetTime();
+    Open_Journal(world);
+
+    glm::ivec3 chunk = static_cast<glm::ivec3>(chunkPos);
+    glm::ivec3 pos = static_cast<glm::ivec3>(tile);
+
+    JournalRecord record = {chunk.x, chunk.y, chunk.z, (pos.x * CHUNK_SIZE + pos.y) * CHUNK_SIZE + pos.z, -1, 0, 0};
+
+    auto changedBlocks = ChangedBlocks.find(chunkPos);
+
+    if (changedBlocks != ChangedBlocks.end() && changedBlocks->second.count(tile)) {
+        std::tie(record.Type, record.Data) = changedBlocks->second.at(tile);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(SaveMutex);
+
+        record.Sequence = NextSequence++;
+        UnwrittenRecords.push_back(record);
+        JournalIndex[chunkPos].push_back(record);
+
+        MainThreadIOTime += glfwGetTime() - startTime;
+    }
+
+    // A read of this chunk that started before the record was made would miss it.
+    std::lock_guard<std::mutex> lock(LoadMutex);
+    ChunkLoads.erase(chunkPos);
+}
+
+std::map<glm::vec3, std::pair<int, int>, VectorComparator> Worlds::Load_Chunk(std::string world, glm::ivec3 pos) {
+    Open_Journal(world);
+
+    while (true) {
+        unsigned long long generation;
+
+        {
+            std::lock_guard<std::mutex> lock(SaveMutex);
+            generation = CompactGeneration;
+        }
+
+        // The file is read without the lock, so that saving never waits for the disk.
+        auto changedBlocks = Read_Chunk(Get_Chunk_Path(world, pos));
+
+        std::lock_guard<std::mutex> lock(SaveMutex);
+
+        // If compaction dropped records in the meantime, the file that was read might not contain them.
+        // Replaying records the file already contains leaves the same result.
+        if (generation != CompactGeneration) {
+            continue;
+        }
+
+        auto records = JournalIndex.find(static_cast<glm::vec3>(pos));
+
+        if (records != JournalIndex.end()) {
+            for (JournalRecord const &record : records->second) {
+                Apply_Record(changedBlocks, record);
+            }
+        }
+
+        return changedBlocks;
+    }
+}
+
+static void IO_Thread() {
+    std::unique_lock<std::mutex> lock(LoadMutex);
+
+    while (true) {
+        LoadCondition.wait(lock, [] { return StopLoading || !LoadTasks.empty(); });
+
+        if (StopLoading) {
+            return;
+        }
+
+        IOTask task = std::move(LoadTasks.front());
+        LoadTasks.pop_front();
+
+        lock.unlock();
+        task.Run();
+        lock.lock();
+    }
+}
+
+// Requires LoadMutex.
+static void Start_IO_Threads() {
+    if (IOThreads.empty()) {
+        StopLoading = false;
+
+        for (int i = 0; i < IO_THREADS; ++i) {
+            IOThreads.emplace_back(IO_Thread);
+        }
+    }
+}
+
+// Starts reading the chunk on the I/O threads unless it's already being read, ahead of prefetches if it's urgent.
+// Requires LoadMutex.
+static std::shared_future<ChunkChanges> &Start_Load(const std::string &world, glm::ivec3 pos, bool urgent) {
+    if (LoadWorld != world) {
+        LoadWorld = world;
+        ChunkLoads.clear();
+    }
+
+    auto load = ChunkLoads.find(static_cast<glm::vec3>(pos));
+
+    if (load != ChunkLoads.end()) {
+        return load->second;
+    }
+
+    Start_IO_Threads();
+
+    auto task = std::make_shared<std::packaged_task<ChunkChanges()>>([world, pos] {
+        return Worlds::Load_Chunk(world, pos);
+    });
+
+    IOTask load = {[task] { (*task)(); }, true, static_cast<glm::vec3>(pos)};
+
+    if (urgent) {
+        LoadTasks.push_front(std::move(load));
+    }
+    else {
+        LoadTasks.push_back(std::move(load));
+    }
+
+    LoadCondition.notify_one();
+    return ChunkLoads[static_cast<glm::vec3>(pos)] = task->get_future().share();
+}
+
+void Worlds::Prefetch_Chunk(std::string world, glm::ivec3 pos) {
+    std::lock_guard<std::mutex> lock(LoadMutex);
+    Start_Load(world, pos, false);
+}
+
+bool Worlds::Receive_Chunk(std::string world, glm::ivec3 pos) {
+    std::unique_lock<std::mutex> lock(LoadMutex);
+    std::shared_future<ChunkChanges> load = Start_Load(world, pos, true);
+
+    if (load.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return false;
+    }
+
+    ChunkLoads.erase(static_cast<glm::vec3>(pos));
+    lock.unlock();
+
+    const ChunkChanges &changedBlocks = load.get();
+    glm::vec3 chunkPos = static_cast<glm::vec3>(pos);
+
+    // Trees of neighbouring chunks that were generated first may have already placed blocks here,
+    // so the saved changes are merged into them, and win where both changed the same block.
+    if (changedBlocks.size() > 0) {
+        auto &chunkChanges = ChangedBlocks[chunkPos];
+
+        for (auto const &block : changedBlocks) {
+            chunkChanges[block.first] = block.second;
+        }
+    }
+
+    return true;
+}
+
+void Worlds::Queue_IO(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(LoadMutex);
+    Start_IO_Threads();
+
+    LoadTasks.push_back({std::move(task), false, glm::vec3()});
+    LoadCondition.notify_one();
+}
+
+void Worlds::Discard_Loads(glm::vec3 center, float distance) {
+    std::lock_guard<std::mutex> lock(LoadMutex);
+
+    // Reads that haven't started yet are dropped from the queue, so that the I/O threads skip them.
+    LoadTasks.erase(std::remove_if(LoadTasks.begin(), LoadTasks.end(), [center, distance](const IOTask &task) {
+        return task.ChunkLoad && glm::distance(center.xz(), task.Position.xz()) >= distance;
+    }), LoadTasks.end());
+
+    for (auto load = ChunkLoads.begin(); load != ChunkLoads.end();) {
+        if (glm::distance(center.xz(), load->first.xz()) >= distance) {
+            load = ChunkLoads.erase(load);
+        }
+        else {
+            ++load;
+        }
+    }
+}
+
+void Worlds::Flush_Journal(bool wait) {
+    std::unique_lock<std::mutex> lock(SaveMutex);
+
+    if (!SaveThread.joinable()) {
+        return;
+    }
+
+    FlushRequested = true;
+    SaveCondition.notify_all();
+
+    if (wait) {
+        SaveCondition.wait(lock, [] { return WrittenSequence + 1 >= NextSequence; });
+    }
+}
+
+void Worlds::Stop_Saving() {
+    {
+        std::lock_guard<std::mutex> lock(LoadMutex);
+
+        StopLoading = true;
+        LoadTasks.clear();
+        ChunkLoads.clear();
+    }
+
+    LoadCondition.notify_all();
+
+    for (std::thread &thread : IOThreads) {
+        thread.join();
+    }
+
+    IOThreads.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(SaveMutex);
+        StopRequested = true;
+    }
+
+    SaveCondition.notify_all();
+
+    if (SaveThread.joinable()) {
+        SaveThread.join();
+    }
+}
+
+std::tuple<double, int, int> Worlds::Get_Save_Stats() {
+    std::lock_guard<std::mutex> lock(SaveMutex);
+    return std::make_tuple(MainThreadIOTime * 1000, RecordsWritten, JournalSize);
+}
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <map>
+#include <tuple>
 #include <string>
 #include <vector>
+#include <functional>
 
 #include "Comparators.h"
 
@@ -25,6 +27,33 @@ namespace Worlds {
 
     std::vector<World> Get_Worlds();
 
-    void Save_Chunk(std::string world, glm::vec3 chunkPos);
+    // Records the block's current entry in ChangedBlocks in the world's journal, which the save thread appends to.
+    void Save_Block(std::string world, glm::vec3 chunkPos, glm::vec3 tile);
+
+    // Reads the chunk's file and replays the journal records made since it was last compacted.
     std::map<glm::vec3, std::pair<int, int>, VectorComparator> Load_Chunk(std::string world, glm::ivec3 pos);
+
+    // Chunks are read by a pool of I/O threads. Prefetching queues the chunk behind the ones needed right away.
+    void Prefetch_Chunk(std::string world, glm::ivec3 pos);
+
+    // Merges the chunk's saved changes into ChangedBlocks if they have been read, and otherwise starts reading them.
+    // Returns whether the chunk is ready to be generated. Only called from the main thread, which owns ChangedBlocks.
+    bool Receive_Chunk(std::string world, glm::ivec3 pos);
+
+    // Forgets chunks read ahead that are now at least this far away, and cancels reads of them that haven't started.
+    void Discard_Loads(glm::vec3 center, float distance);
+
+    // Runs a task on the I/O threads after the chunks queued so far.
+    void Queue_IO(std::function<void()> task);
+
+    // Wakes up the save thread to append the recorded changes now, optionally waiting until they are written.
+    void Flush_Journal(bool wait = false);
+
+    // Stops the I/O threads, writes the remaining changes, compacts the journal into the chunk files
+    // and stops the save thread.
+    void Stop_Saving();
+
+    // Time spent saving and loading on the main thread in milliseconds, journal records written,
+    // and records waiting to be compacted.
+    std::tuple<double, int, int> Get_Save_Stats();
 };
\ No newline at end of file
@@ -10,6 +10,9 @@
 #include <sstream>
 #include <fstream>
 
+// For checking whether a display is available.
+#include <cstdlib>
+
 #include "UI.h"
 #include "Chat.h"
 #include "Sound.h"
@@ -21,8 +24,11 @@
 #include "Shader.h"
 #include "Worlds.h"
 #include "Network.h"
+#include "Benchmark.h"
 #include "Interface.h"
 #include "Inventory.h"
+#include "ChunkCache.h"
+#include "RenderQueue.h"
 
 #include "../BlockScripts/Block_Scripts.h"
 
@@ -89,6 +95,7 @@ std::unordered_map<glm::vec3, Chunk*, VectorHasher> ChunkMap;
 bool AMBIENT_OCCLUSION = false;
 bool FULLSCREEN        = true;
 bool VSYNC             = true;
+bool CHUNK_CACHE       = false;
 
 int FOV                   = 90;
 int MIPMAP_LEVEL          = 4;
@@ -96,16 +103,19 @@ int SCREEN_HEIGHT         = 1080;
 int SCREEN_WIDTH          = 1920;
 int RENDER_DISTANCE       = 4;
 int ANISOTROPIC_FILTERING = 16;
+int CHUNK_CACHE_MEMORY    = 64;
 
 // List of option references.
 static std::map<std::string, bool*> BoolOptions = {
     {"AmbientOcclusion", &AMBIENT_OCCLUSION},
+    {"ChunkCache",       &CHUNK_CACHE},
     {"FullScreen",       &FULLSCREEN},
     {"VSync",            &VSYNC}
 };
 
 static std::map<std::string, int*> IntOptions = {
     {"AnisotropicFiltering", &ANISOTROPIC_FILTERING},
+    {"ChunkCacheMemory",     &CHUNK_CACHE_MEMORY},
     {"RenderDistance",       &RENDER_DISTANCE},
     {"WindowResY",           &SCREEN_HEIGHT},
     {"WindowResX",           &SCREEN_WIDTH},
@@ -118,12 +128,15 @@ Shader* shader        = nullptr;
 Shader* mobShader     = nullptr;
 Shader* modelShader   = nullptr;
 Shader* outlineShader = nullptr;
+Shader* damageShader  = nullptr;
+Shader* itemShader    = nullptr;
+Shader* playerShader  = nullptr;
 
 // Sets settings according to the config file.
 void Parse_Config();
 
 // Initialize different objects and states.
-void Init_GL();
+void Init_GL(bool hidden = false);
 void Init_Shaders();
 void Init_Outline();
 void Init_Textures();
@@ -132,6 +145,9 @@ void Init_Rendering();
 // Renders the main scene.
 void Render_Scene();
 
+// Renders the scene, other players and entities.
+void Render_World();
+
 // The background thread that handles chunk generation.
 void Background_Thread();
 
@@ -145,24 +161,75 @@ void Key_Proxy(GLFWwindow* window, int key, int scancode, int action, int mods);
 void Window_Focused(GLFWwindow* window, int focused);
 void Window_Minimized(GLFWwindow* window, int iconified);
 
-int main() {
+// Records how long a startup step took since the previous one, and prints every step once the last one is done.
+void Time_Startup_Step(std::string step, bool last = false);
+
+int main(int argc, char* argv[]) {
+    // Benchmark chunk meshing without opening a window, optionally with a number of iterations.
+    if (argc > 1 && std::string(argv[1]) == "--bench-mesh") {
+        Blocks::Init();
+        Chunks::Load_Structures();
+
+        return Benchmark::Mesh_Chunks(argc > 2 ? std::stoi(argv[2]) : 100);
+    }
+
+    // Render a fixed-seed world along a scripted camera path in a hidden window,
+    // optionally with a number of frames and the CSV file to write the results to.
+    bool renderBenchmark = argc > 1 && std::string(argv[1]) == "--bench-render";
+
+#ifdef GLFW_PLATFORM_NULL
+    // Without a display, render in software through OSMesa on GLFW's null platform.
+    if (renderBenchmark && std::getenv("DISPLAY") == nullptr && std::getenv("WAYLAND_DISPLAY") == nullptr) {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif
+
     // Initialize GLFW, the library responsible for windowing, events, etc...
     glfwInit();
+    Time_Startup_Step("");
 
     Parse_Config();
     Blocks::Init();
     Chunks::Load_Structures();
+    Time_Startup_Step("Config, blocks and structures");
+
+    Init_GL(renderBenchmark);
+    Time_Startup_Step("OpenGL context");
 
-    Init_GL();
     Init_Textures();
+    Time_Startup_Step("Textures");
+
     Init_Shaders();
     Init_Outline();
+    Time_Startup_Step("Shaders");
+
     Init_Rendering();
+    Time_Startup_Step("Rendering");
 
     UI::Init();
     player.Init();
+    Time_Startup_Step("Interface and player");
 
     Init_Block_Scripts();
+    Time_Startup_Step("Block scripts", true);
+
+    if (renderBenchmark) {
+        GamePaused = false;
+        std::thread chunkGeneration(Background_Thread);
+
+        int result = Benchmark::Render_Path(
+            argc > 2 ? std::stoi(argv[2]) : 600,
+            argc > 3 ? argv[3] : "render_benchmark.csv",
+            Render_World
+        );
+
+        glfwSetWindowShouldClose(Window, true);
+        chunkGeneration.join();
+        Worlds::Stop_Saving();
+        glfwTerminate();
+
+        return result;
+    }
 
     // Start the background thread.
     std::thread chunkGeneration(Background_Thread);
@@ -196,7 +263,6 @@ int main() {
 
             Network::Update();
             Network::Update_Players();
-            Network::Render_Players();
         }
 
         if (!GamePaused) {
@@ -212,8 +278,7 @@ int main() {
                 Entity::Update();
             }
 
-            Render_Scene();
-            Entity::Draw();
+            Render_World();
             player.Draw();
         }
 
@@ -226,6 +291,9 @@ int main() {
 
         // Swap the newly rendered frame with the old one.
         glfwSwapBuffers(Window);
+
+        LastFrameDrawStateCalls = DrawStateCalls;
+        DrawStateCalls = 0;
     }
 
     if (WORLD_NAME != "") {
@@ -239,6 +307,7 @@ int main() {
 
     // On shutting down, join the chunk generation thread with the main thread.
     chunkGeneration.join();
+    Worlds::Stop_Saving();
 
     // Shut down the graphics library, and return.
     glfwTerminate();
@@ -287,7 +356,7 @@ void Write_Config() {
     file.close();
 }
 
-void Init_GL() {
+void Init_GL(bool hidden) {
     // Set the OpenGL version.
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
@@ -297,7 +366,18 @@ void Init_GL() {
     glfwWindowHint(GLFW_RESIZABLE, false);
 	glfwWindowHint(GLFW_AUTO_ICONIFY, false);
 
-    if (FULLSCREEN) {
+    if (hidden) {
+        glfwWindowHint(GLFW_VISIBLE, false);
+
+#ifdef GLFW_PLATFORM_NULL
+        if (glfwGetPlatform() == GLFW_PLATFORM_NULL) {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+        }
+#endif
+
+        Window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Craftmine", nullptr, nullptr);
+    }
+    else if (FULLSCREEN) {
         // Stops the window from having any decoration, such as a title bar.
         glfwWindowHint(GLFW_DECORATED, false);
 
@@ -386,9 +466,12 @@ void Init_Shaders() {
     mobShader     = new Shader("model2DTex");
     modelShader   = new Shader("model");
     outlineShader = new Shader("outline");
+    damageShader  = new Shader("damage");
+    itemShader    = new Shader("item");
+    playerShader  = new Shader("player");
 
     // Create the frustrum projection matrix for the camera.
-    glm::mat4 projection = glm::perspective(
+    Cam.Projection = glm::perspective(
         glm::radians(static_cast<float>(FOV)),
         static_cast<float>(SCREEN_WIDTH) / SCREEN_HEIGHT,
         Z_NEAR_LIMIT, Z_FAR_LIMIT
@@ -396,10 +479,10 @@ void Init_Shaders() {
 
     // Create a matrix storage block in the shaders referenced in the last argument.
     UBO.Create("Matrices", 0, 2 * sizeof(glm::mat4),
-        {shader, outlineShader, modelShader, mobShader}
+        {shader, outlineShader, modelShader, mobShader, damageShader, itemShader, playerShader}
     );
 
-    UBO.Upload(1, projection);
+    UBO.Upload(1, Cam.Projection);
 }
 
 void Init_Outline() {
@@ -439,6 +522,8 @@ void Init_Outline() {
 }
 
 void Init_Rendering() {
+    Chunks::Init_Arena(shader);
+
     // Default identity matrix, does nothing.
     glm::mat4 model;
 
@@ -454,10 +539,15 @@ void Init_Rendering() {
     // Upload the texture unit index of the main textures.
     shader->Upload("diffTex", 0);
     modelShader->Upload("tex", 0);
+    damageShader->Upload("diffTex", 0);
+    itemShader->Upload("tex", 0);
 }
 
 void Render_Scene() {
-    UBO.Upload(0, Cam.GetViewMatrix());
+    glm::mat4 view = Cam.GetViewMatrix();
+    UBO.Upload(0, view);
+
+    Chunks::Cull(Cam.Projection * view, Cam.Position);
 
     if (ToggleWireframe) {
         Wireframe = !Wireframe;
@@ -471,24 +561,17 @@ void Render_Scene() {
         shader->Upload("diffTex", Wireframe ? 50 : 0);
     }
 
-    // Set the first rendering pass to discard any transparent fragments.
-    shader->Upload("RenderTransparent", false);
-
-    for (auto const &chunk : ChunkMap) {
-		chunk.second->Draw();
-    }
-
-    // Set the second rendering pass to discard any opaque fragments.
-    shader->Upload("RenderTransparent", true);
-
-    for (auto const &chunk : ChunkMap) {
-		chunk.second->Draw(true);
-    }
+    // Draw the opaque part of every chunk first, nearest first so that hidden fragments fail the depth test early.
+    // Then blend the transparent parts on top, farthest first.
+    Chunks::Draw();
+    Chunks::Draw(true);
 
     if (!player.LookingAtBlock || player.LookingBlockType == nullptr) {
         return;
     }
 
+    player.Draw_Damage();
+
     // Start with an empty identity matrix.
     glm::mat4 model;
 
@@ -503,6 +586,22 @@ void Render_Scene() {
     OutlineBuffer.Draw();
 }
 
+void Render_World() {
+    // Merge the saved changes read since the last frame, and hand this frame's remesh requests to the meshing thread.
+    Chunks::Receive_Loads();
+    Chunks::Schedule_Remeshes();
+
+    Render_Scene();
+
+    if (Multiplayer) {
+        Network::Render_Players();
+    }
+
+    // Other players and entities are queued, and drawn together sorted by state.
+    Entity::Draw();
+    RenderQueue::Flush();
+}
+
 void Background_Thread() {
 	while (true) {
 		if (glfwWindowShouldClose(Window)) {
@@ -521,6 +620,9 @@ void Background_Thread() {
 			;
         }
 
+        // Remeshes of already visible chunks go before new chunks.
+        Chunks::Process_Remeshes();
+
         // Get the XZ-location of the player.
         glm::vec2 playerPos = player.CurrentChunk.xz();
         float nearestDistance = static_cast<float>(RENDER_DISTANCE);
@@ -540,6 +642,11 @@ void Background_Thread() {
 				continue;
 			}
 
+            // Chunks are generated once the main thread has merged their saved changes.
+            if (!chunk.second->Loaded) {
+                continue;
+            }
+
             if (dist < nearestDistance) {
                 nearestDistance = dist;
                 nearestChunk = chunk.second;
@@ -553,23 +660,20 @@ void Background_Thread() {
 
         // Checks if there's a chunk to be rendered.
         if (nearestChunk != nullptr) {
-            if (!nearestChunk->Generated) {
+            if (!nearestChunk->Generated && !ChunkCache::Restore(nearestChunk)) {
                 nearestChunk->Generate();
             }
 
             nearestChunk->Light();
             nearestChunk->Mesh();
-
-            nearestChunk->Meshed = true;
-            nearestChunk->DataUploaded = false;
             queueEmpty = false;
         }
 
         // Show that the thread is no longer using the chunk map.
 		ChunkMapBusy.clear(std::memory_order_release);
 
-        // Sleep for 1 ms if there's still chunks to be generated, else sleep for 100 ms.
-        std::this_thread::sleep_for(std::chrono::milliseconds(queueEmpty ? 100 : 1));
+        // Wait 1 ms if there's still chunks to be generated, else 100 ms, unless remeshes are scheduled.
+        Chunks::Wait_For_Work(queueEmpty ? 100 : 1);
     }
 }
 
@@ -631,3 +735,22 @@ void Exit(void* caller) { glfwSetWindowShouldClose(Window, true); }
 #elif _MSC_VER
     #pragma warning(pop)
 #endif
+
+void Time_Startup_Step(std::string step, bool last) {
+    static double startTime = glfwGetTime();
+    static double lastTime = startTime;
+    static std::ostringstream steps;
+
+    double currentTime = glfwGetTime();
+
+    if (!step.empty()) {
+        steps << "\n    " << step << ": " << static_cast<int>((currentTime - lastTime) * 1000) << " ms";
+    }
+
+    lastTime = currentTime;
+
+    if (last) {
+        int total = static_cast<int>((currentTime - startTime) * 1000);
+        std::cout << "Started in " << total << " ms" << steps.str() << std::endl;
+    }
+}
@@ -32,6 +32,9 @@ extern Shader* shader;
 extern Shader* mobShader;
 extern Shader* modelShader;
 extern Shader* outlineShader;
+extern Shader* damageShader;
+extern Shader* itemShader;
+extern Shader* playerShader;
 
 // Defining references to objects.
 extern Camera Cam;
@@ -106,6 +109,13 @@ const glm::vec2 tex_coords[6][6] = {
     { {0, 1}, {1, 1}, {1, 0}, {1, 0}, {0, 0}, {0, 1} }
 };
 
+// Indices into the vertex lists above for the 4 corners of each side,
+// used when a side is drawn as an indexed quad (triangles 0-1-2 and 2-3-0).
+const int quad_corners[6][4] = {
+    {1, 2, 0, 5}, {0, 1, 2, 5}, {0, 1, 2, 4},
+    {1, 2, 0, 4}, {1, 2, 0, 4}, {0, 1, 2, 4}
+};
+
 // Texture coordinates for the different body parts of the player model.
 const std::map<std::string, std::vector<std::vector<glm::vec2>>> PlayerTexCoords = {
     {"head", {
@@ -145,6 +155,12 @@ extern bool VSYNC;
 extern bool FULLSCREEN;
 extern bool AMBIENT_OCCLUSION;
 
+// Whether generated chunks are also cached on disk, so that revisiting them skips generation and lighting.
+extern bool CHUNK_CACHE;
+
+// Megabytes of memory for compressed chunks that were recently unloaded.
+extern int CHUNK_CACHE_MEMORY;
+
 // Used for storing the time difference between the current frame and the last (in seconds).
 extern double DeltaTime;
 
@@ -0,0 +1,19 @@
+#version 410 core
+
+in vec2 TexCoords;
+
+out vec4 FragColor;
+
+uniform float damageTexture;
+uniform sampler2DArray diffTex;
+
+void main() {
+    float alpha = texture(diffTex, vec3(TexCoords, damageTexture)).a;
+
+    if (alpha == 0.0f) {
+        discard;
+    }
+
+    // Darkens the block underneath where the cracks are.
+    FragColor = vec4(vec3(0.0f), 0.5f * alpha);
+}
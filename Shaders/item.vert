@@ -0,0 +1,28 @@
+#version 410 core
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 texCoords;
+
+// Per item.
+layout (location = 2) in vec3 offset;
+layout (location = 3) in float rotation;
+layout (location = 4) in float lightLevel;
+
+out vec3 TexCoords;
+out float LightLevel;
+
+layout (std140) uniform Matrices {
+    uniform mat4 view;
+    uniform mat4 projection;
+};
+
+void main() {
+    float c = cos(rotation);
+    float s = sin(rotation);
+
+    vec3 rotated = vec3(c * position.x + s * position.z, position.y, c * position.z - s * position.x);
+
+    gl_Position = projection * view * vec4(rotated + offset, 1.0f);
+    TexCoords = texCoords;
+    LightLevel = lightLevel;
+}
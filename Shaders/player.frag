@@ -0,0 +1,13 @@
+#version 410 core
+
+in vec2 TexCoords;
+in float LightLevel;
+
+out vec4 FragColor;
+
+uniform sampler2D tex;
+
+void main() {
+    vec4 text = texture(tex, TexCoords);
+    FragColor = vec4((0.1f + 0.9f * (LightLevel / 15.0f)) * text.rgb, text.a);
+}
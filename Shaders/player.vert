@@ -0,0 +1,66 @@
+#version 410 core
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texCoords;
+layout (location = 2) in float part;
+
+// Per player.
+layout (location = 3) in vec3 offset;
+layout (location = 4) in vec3 right;
+layout (location = 5) in vec4 angles;
+layout (location = 6) in float lightLevel;
+
+out vec2 TexCoords;
+out float LightLevel;
+
+layout (std140) uniform Matrices {
+    uniform mat4 view;
+    uniform mat4 projection;
+};
+
+// Head, body, left arm, right arm, left leg and right leg.
+const vec3 PartOffsets[6] = vec3[](
+    vec3(0, 1.5, 0), vec3(0, 0.75, 0), vec3(0, 1.5, 0),
+    vec3(0, 1.5, 0), vec3(0, 0.75, 0), vec3(0, 0.75, 0)
+);
+
+const vec3 PartScales[6] = vec3[](
+    vec3(0.5, 0.5, 0.5), vec3(0.5, 0.75, 0.25), vec3(0.25, 0.75, 0.25),
+    vec3(0.25, 0.75, 0.25), vec3(0.25, 0.75, 0.25), vec3(0.25, 0.75, 0.25)
+);
+
+vec3 rotate(vec3 v, vec3 axis, float angle) {
+    float c = cos(angle);
+    float s = sin(angle);
+
+    return v * c + cross(axis, v) * s + axis * dot(axis, v) * (1.0f - c);
+}
+
+void main() {
+    int index = int(part);
+
+    // Yaw, head pitch, leg and left arm swing, and right arm swing.
+    float yaw = angles.x;
+    float pitch = angles.y;
+    float swing = (index == 2 || index == 5) ? -angles.z : angles.z;
+
+    if (index == 3) {
+        swing = angles.w;
+    }
+
+    vec3 pos = position * PartScales[index];
+
+    if (index == 0) {
+        pos = rotate(pos, vec3(1, 0, 0), pitch);
+    }
+
+    pos = rotate(pos, vec3(0, 1, 0), yaw);
+
+    if (index >= 2) {
+        pos = rotate(pos, right, swing);
+    }
+
+    gl_Position = projection * view * vec4(pos + offset + PartOffsets[index], 1.0f);
+    TexCoords = texCoords;
+    LightLevel = lightLevel;
+}
@@ -3,7 +3,6 @@
 in vec3 TexCoords;
 in float LightLevel;
 in float AO;
-in float ExtraTexture;
 
 out vec4 FragColor;
 
@@ -11,17 +10,11 @@ uniform vec3 ambient;
 uniform vec3 diffuse;
 
 uniform sampler2DArray diffTex;
-uniform bool RenderTransparent = false;
 
 void main() {
     vec4 tex = texture(diffTex, TexCoords);
 
-    if (ExtraTexture > 0) {
-        vec4 tex2 = texture(diffTex, vec3(TexCoords.xy, ExtraTexture));
-        tex = vec4(tex.rgb * (1 - (0.5f * tex2.a)), tex.a);
-    }
-
-    if ((RenderTransparent && tex.a == 1.0f) || (!RenderTransparent && tex.a < 1.0f)) {
+    if (tex.a == 0.0f) {
         discard;
     }
 
@@ -0,0 +1,133 @@
+#include "Journal.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+
+#include <boost/filesystem.hpp>
+
+static int Failures = 0;
+
+static void Check(bool condition, const char* message) {
+    if (!condition) {
+        std::printf("FAILED: %s\n", message);
+        ++Failures;
+    }
+}
+
+static JournalRecord Make_Record(unsigned long long sequence) {
+    int value = static_cast<int>(sequence);
+    return {value, -value, value * 2, value * 3, value % 7, value % 5, sequence};
+}
+
+static bool Same_Record(const JournalRecord &a, const JournalRecord &b) {
+    return a.ChunkX == b.ChunkX && a.ChunkY == b.ChunkY && a.ChunkZ == b.ChunkZ && a.Index == b.Index &&
+           a.Type == b.Type && a.Data == b.Data && a.Sequence == b.Sequence;
+}
+
+static bool Same_Records(const std::vector<JournalRecord> &a, const std::vector<JournalRecord> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    for (unsigned long i = 0; i < a.size(); ++i) {
+        if (!Same_Record(a[i], b[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// A crash in the middle of an append leaves part of a record at the end of the journal.
+static void Test_Torn_Record(const std::string &path) {
+    std::vector<JournalRecord> written = {Make_Record(1), Make_Record(2), Make_Record(3)};
+    Check(Journal::Append(path, written), "appending records");
+
+    JournalRecord torn = Make_Record(4);
+
+    {
+        std::ofstream file(path, std::ofstream::binary | std::ofstream::app);
+        file.write(reinterpret_cast<const char*>(&torn), sizeof(JournalRecord) / 2);
+    }
+
+    Check(Same_Records(Journal::Read(path), written), "replaying the records before a torn one");
+    Check(
+        boost::filesystem::file_size(path) == written.size() * sizeof(JournalRecord),
+        "cutting off the torn record"
+    );
+
+    std::vector<JournalRecord> appended = {Make_Record(5), Make_Record(6)};
+    Check(Journal::Append(path, appended), "appending after a torn record");
+
+    written.insert(written.end(), appended.begin(), appended.end());
+    Check(Same_Records(Journal::Read(path), written), "replaying records appended after a torn one");
+
+    Journal::Clear(path);
+    Check(Journal::Read(path).empty(), "clearing the journal");
+}
+
+static std::string Read_File(const std::string &path) {
+    std::ifstream file(path, std::ifstream::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static bool Old_Or_New(const std::string &path, const std::string &oldContents, const std::string &newContents) {
+    std::string contents = Read_File(path);
+    return contents == oldContents || contents == newContents;
+}
+
+// Chunk files are replaced while compacting, and an interrupted replace must leave either the old or the new file.
+static void Test_Interrupted_Replace(const std::string &path) {
+    const std::string oldContents = "123:-456a:2-";
+    const std::string newContents = "789b:-";
+    std::string tempPath = path + ".tmp";
+
+    Check(Journal::Replace_File(path, oldContents), "writing a chunk file");
+    Check(Read_File(path) == oldContents, "reading back a chunk file");
+
+    // A directory in the way of the temporary file makes the write fail partway through.
+    boost::filesystem::create_directory(tempPath);
+
+    Check(!Journal::Replace_File(path, newContents), "reporting a failed write");
+    Check(Read_File(path) == oldContents, "keeping the old chunk file after a failed write");
+    Check(!boost::filesystem::exists(tempPath), "removing the temporary file after a failed write");
+
+    // A crash in the middle of writing leaves a truncated temporary file behind.
+    {
+        std::ofstream partial(tempPath, std::ofstream::binary | std::ofstream::trunc);
+        partial << newContents.substr(0, newContents.size() / 2);
+    }
+
+    Check(Old_Or_New(path, oldContents, newContents), "keeping a whole chunk file after a crash");
+
+    Check(Journal::Replace_File(path, newContents), "writing over a file left by a crash");
+    Check(Read_File(path) == newContents, "reading back a chunk file written after a crash");
+    Check(!boost::filesystem::exists(tempPath), "renaming the temporary file");
+    Check(Journal::Sync_Directory(boost::filesystem::path(path).parent_path().string()), "syncing the directory");
+}
+
+static void Test_Missing_Journal(const std::string &path) {
+    Check(Journal::Read(path).empty(), "reading a journal that doesn't exist");
+}
+
+int main() {
+    boost::filesystem::path directory = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(directory);
+
+    Test_Missing_Journal((directory / "Missing.bin").string());
+    Test_Torn_Record((directory / "Journal.bin").string());
+    Test_Interrupted_Replace((directory / "0,0,0.chunk").string());
+
+    boost::filesystem::remove_all(directory);
+
+    if (Failures > 0) {
+        std::printf("%d checks failed\n", Failures);
+        return 1;
+    }
+
+    std::printf("All checks passed\n");
+    return 0;
+}